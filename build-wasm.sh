@@ -4,7 +4,6 @@ set -e
 
 SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
 BUILD_DIR="${SCRIPT_DIR}/build"
-ASSETS_DIR="${SCRIPT_DIR}/assets"
 SOURCES_DIR="${SCRIPT_DIR}/src"
 
 # Source shell configuration files to get PATH and aliases
@@ -55,6 +54,11 @@ fi
 
 mkdir -p "${BUILD_DIR}"
 
+# The packer runs here, so it's built with the host compiler, not emcc
+echo "Packing assets..."
+"${HOST_CXX:-c++}" -std=c++17 -O2 -I"${SOURCES_DIR}" "${SCRIPT_DIR}/tools/pack.cc" -o "${BUILD_DIR}/snake++-pack"
+(cd "${SCRIPT_DIR}" && "${BUILD_DIR}/snake++-pack" --out="${BUILD_DIR}/assets.pak" assets)
+
 echo "Compiling sources..."
 emcc \
     $(find "${SOURCES_DIR}" -name "*.cc") \
@@ -71,8 +75,7 @@ emcc \
     -s USE_WEBGL2=1 \
     -s FULL_ES3=1 \
     -O2 \
-    --preload-file "${ASSETS_DIR}@/assets" \
-    --use-preload-plugins \
+    --preload-file "${BUILD_DIR}/assets.pak@/assets.pak" \
     -s EXPORTED_RUNTIME_METHODS='["ccall","cwrap","FS","print","printErr"]' \
     -s EXPORTED_FUNCTIONS='["_main","_malloc","_free"]' \
     -s ASYNCIFY \
@@ -84,9 +87,6 @@ emcc \
 
 cp index.html "${BUILD_DIR}/"
 
-echo "Copying assets..."
-cp -r "${ASSETS_DIR}" "${BUILD_DIR}/" || true
-
 echo ""
 echo "Build complete! Output files are in: ${BUILD_DIR}"
 echo "Open ${BUILD_DIR}/snake++.html in a web browser to play."
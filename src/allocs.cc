@@ -0,0 +1,34 @@
+#include "allocs.h"
+
+#ifdef SNAKEPP_COUNT_ALLOCS
+
+#include <cstdlib>
+#include <new>
+
+// Per thread, so the simulation thread's allocations don't show up in the main thread's frames.
+// Constant initialized, so touching it never allocates.
+static thread_local uint64_t t_alloc_count = 0;
+
+bool allocCountingEnabled(){ return true; }
+uint64_t allocCount(){ return t_alloc_count; }
+
+// The array and sized forms all end up here or in free(). The aligned forms are left to the
+// standard library, they use their own allocator and nothing in the game asks for them.
+void* operator new(std::size_t size){
+	t_alloc_count++;
+	if (void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+void* operator new[](std::size_t size){ return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+#else
+
+bool allocCountingEnabled(){ return false; }
+uint64_t allocCount(){ return 0; }
+
+#endif // SNAKEPP_COUNT_ALLOCS
@@ -0,0 +1,13 @@
+#ifndef ALLOCS_H
+#define ALLOCS_H
+
+// Heap allocation counter, for checking that per-frame code doesn't allocate. Only counts in builds
+// configured with -DSNAKEPP_COUNT_ALLOCS=ON, which replaces the global operator new. Otherwise
+// allocCount() is always 0.
+
+#include <cstdint>
+
+bool allocCountingEnabled();
+uint64_t allocCount(); // Allocations made through operator new so far, on the calling thread
+
+#endif // ALLOCS_H
@@ -0,0 +1,172 @@
+#include "assetpack.h"
+
+#include <SDL2/SDL.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef SNAKEPP_EMBED_ASSETS
+// Generated by snake++-pack --embed
+extern const unsigned char g_embedded_pack[];
+extern const size_t g_embedded_pack_size;
+#endif
+
+static bool tried = false;
+static const uint8_t* pack = nullptr;
+static size_t pack_size = 0;
+static bool mapped = false; // pack was mapped by us, rather than linked in
+static std::string source = "loose files";
+#ifdef _WIN32
+static HANDLE mapping = NULL;
+#endif
+
+static const PackHeader* header(){ return (const PackHeader*)pack; }
+static const PackEntry* entries(){ return (const PackEntry*)(pack + sizeof(PackHeader)); }
+
+static bool validPack(const uint8_t* data, size_t size){
+	if (size < sizeof(PackHeader))
+		return false;
+	const PackHeader* h = (const PackHeader*)data;
+	if (memcmp(h->magic, PACK_MAGIC, 4) != 0 || h->version != PACK_VERSION)
+		return false;
+	if (h->count > (size - sizeof(PackHeader))/sizeof(PackEntry))
+		return false;
+	const PackEntry* e = (const PackEntry*)(data + sizeof(PackHeader));
+	for (uint32_t i = 0; i < h->count; i++){
+		if (e[i].path[PACK_PATH_LEN-1] != '\0' || e[i].offset > size || e[i].size > size - e[i].offset)
+			return false;
+		if (i > 0 && strcmp(e[i-1].path, e[i].path) >= 0) // Has to be sorted for findPackedAsset
+			return false;
+	}
+	return true;
+}
+
+#ifndef SNAKEPP_EMBED_ASSETS
+// Maps path read only, leaving pack and pack_size set. Returns false if it can't.
+static bool mapPack(const std::string& path){
+	#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file); // The mapping keeps it open
+	if (!mapping)
+		return false;
+	pack = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!pack){
+		CloseHandle(mapping);
+		mapping = NULL;
+		return false;
+	}
+	pack_size = size.QuadPart;
+	#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	void* data = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+		data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // The mapping keeps it open
+	if (data == MAP_FAILED)
+		return false;
+	pack = (const uint8_t*)data;
+	pack_size = st.st_size;
+	#endif
+	mapped = true;
+	return true;
+}
+#endif
+
+static void unmapPack(){
+	if (mapped){
+		#ifdef _WIN32
+		UnmapViewOfFile(pack);
+		CloseHandle(mapping);
+		mapping = NULL;
+		#else
+		munmap((void*)pack, pack_size);
+		#endif
+	}
+	pack = nullptr;
+	pack_size = 0;
+	mapped = false;
+}
+
+bool openAssetPack(){
+	if (tried)
+		return pack != nullptr;
+	tried = true;
+
+	#ifdef SNAKEPP_EMBED_ASSETS
+	pack = g_embedded_pack;
+	pack_size = g_embedded_pack_size;
+	source = "embedded pack";
+	#else
+	// Next to the executable first, so it doesn't matter where the game was started from
+	std::string path = PACK_NAME;
+	char* base = SDL_GetBasePath();
+	if (base){
+		path = std::string(base) + PACK_NAME;
+		SDL_free(base);
+	}
+	if (!mapPack(path) && path != PACK_NAME){
+		path = PACK_NAME;
+		mapPack(path);
+	}
+	if (!pack)
+		return false; // No pack, not a problem
+	source = path;
+	#endif
+
+	if (!validPack(pack, pack_size)){
+		std::cerr << "File Error: \"" << source << "\" is not a valid asset pack, reading the loose files instead\n";
+		unmapPack();
+		source = "loose files";
+		return false;
+	}
+	return true;
+}
+
+void closeAssetPack(){
+	unmapPack();
+	source = "loose files";
+	tried = false;
+}
+
+bool findPackedAsset(const char* path, const void*& data, size_t& size){
+	if (!pack)
+		return false;
+	// Binary search, the entries are sorted by path
+	uint32_t lo = 0, hi = header()->count;
+	while (lo < hi){
+		uint32_t mid = (lo + hi)/2;
+		int cmp = strcmp(entries()[mid].path, path);
+		if (cmp == 0){
+			data = pack + entries()[mid].offset;
+			size = entries()[mid].size;
+			return true;
+		}
+		if (cmp < 0)
+			lo = mid+1;
+		else
+			hi = mid;
+	}
+	return false;
+}
+
+const char* assetPackSource(){
+	return source.c_str();
+}
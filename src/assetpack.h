@@ -0,0 +1,45 @@
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+// Asset pack: every file under assets/ in one archive, made at build time by snake++-pack
+// (tools/pack.cc). The game maps it into memory, or links it in with -DSNAKEPP_EMBED_ASSETS=ON,
+// and decodes assets straight out of it with no copies and no per-file syscalls. Without a pack
+// the loose files in assets/ are read instead.
+//
+// Layout: a PackHeader, then count PackEntry records sorted by path, then the files' bytes, each
+// starting on a multiple of PACK_ALIGN. Numbers are little endian. Nothing here needs SDL, so the
+// packer can share it.
+
+#include <cstddef>
+#include <cstdint>
+
+#define PACK_NAME "assets.pak" // Looked for next to the executable, then in the working directory
+#define PACK_MAGIC "SNPK"
+#define PACK_VERSION 1
+#define PACK_ALIGN 64 // Cache line
+#define PACK_PATH_LEN 56 // Including the terminating zero
+
+struct PackHeader {
+	char magic[4]; // PACK_MAGIC
+	uint32_t version;
+	uint32_t count; // Entries
+	uint32_t reserved;
+};
+
+struct PackEntry {
+	char path[PACK_PATH_LEN]; // As the game asks for it, e.g. "assets/fonts/pixel-letters.ttf"
+	uint32_t offset; // From the start of the pack
+	uint32_t size;
+};
+
+static_assert(sizeof(PackHeader) == 16 && sizeof(PackEntry) == 64, "Pack records must have no padding");
+
+// Opens the embedded pack, or else maps PACK_NAME. Returns false if there isn't one (or it's
+// damaged), then assets come from the loose files. Only looks once until closeAssetPack.
+bool openAssetPack();
+void closeAssetPack(); // Anything read from the pack is gone after this
+// Where path's bytes are in the pack. Returns false if it isn't in there.
+bool findPackedAsset(const char* path, const void*& data, size_t& size);
+const char* assetPackSource(); // Where the pack came from, for the startup report
+
+#endif // ASSETPACK_H
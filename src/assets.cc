@@ -0,0 +1,255 @@
+#include "assets.h"
+#include "assetpack.h"
+#include "workpool.h"
+
+#include <cstring>
+#include <mutex>
+
+typedef enum AssetKind {
+	AK_FONT,
+	AK_IMAGE,
+	AK_SOUND,
+} AssetKind;
+
+struct AssetDesc {
+	AssetKind kind;
+	int type; // FontType, ImageType or SoundType
+	const char* path;
+	int pt; // Font size
+};
+
+static const AssetDesc ASSETS[] = {
+	{AK_FONT, F_SMALL, FONT_PATH, FONT_SIZE_SMALL},
+	{AK_FONT, F_MED, FONT_PATH, FONT_SIZE_MED},
+	{AK_FONT, F_LARGE, FONT_PATH, FONT_SIZE_LARGE},
+	{AK_IMAGE, IMG_AUDIO_ON, IMG_PATH_AUDIO_ON, 0},
+	{AK_IMAGE, IMG_AUDIO_OFF, IMG_PATH_AUDIO_OFF, 0},
+	{AK_SOUND, S_EAT, SND_PATH_EAT, 0},
+	{AK_SOUND, S_EXPLOSION, SND_PATH_EXPLOSION, 0},
+	{AK_SOUND, S_MENUHOVER, SND_PATH_MENUHOVER, 0},
+	{AK_SOUND, S_MENUSELECT, SND_PATH_MENUSELECT, 0},
+};
+
+#define NUM_ASSETS (sizeof(ASSETS)/sizeof(ASSETS[0]))
+
+struct AssetFile {
+	const char* path;
+	const void* data; // In the asset pack, or from SDL_LoadFile. nullptr if it couldn't be read.
+	size_t size;
+	double read_ms;
+	bool keep; // A font reads from it as it goes
+	bool owned; // From SDL_LoadFile, rather than a view of the pack
+};
+
+struct AssetTiming {
+	bool loaded;
+	int file; // Index into files
+	bool first_use; // The asset the file's read is put down to
+	bool failed;
+	double decode_ms, upload_ms;
+};
+
+static std::vector<AssetFile> files; // Kept while fonts use them, see freeAssetFiles
+static std::array<SDL_Surface*, NUM_IMG> images = {};
+static std::array<Mix_Chunk*, NUM_SOUNDS> sounds = {};
+static std::array<AssetTiming, NUM_ASSETS> timings = {};
+static double load_ms = 0; // Wall time spent in loadAssets
+static int load_threads = 0;
+
+static double msSince(Uint64 start){
+	return (SDL_GetPerformanceCounter() - start)*1000.0/SDL_GetPerformanceFrequency();
+}
+
+static int kindFlag(AssetKind kind){
+	switch (kind){
+		case AK_FONT: return AS_FONTS;
+		case AK_IMAGE: return AS_IMAGES;
+		case AK_SOUND: return AS_SOUNDS;
+	}
+	return 0;
+}
+
+// Decodes ASSETS[i] from its file's bytes. Runs on a worker thread.
+static void decodeAsset(size_t i){
+	const AssetDesc& desc = ASSETS[i];
+	AssetTiming& timing = timings[i];
+	const AssetFile& file = files[timing.file];
+	Uint64 start = SDL_GetPerformanceCounter();
+	if (!file.data){
+		timing.failed = true;
+		return;
+	}
+	switch (desc.kind){
+		case AK_FONT:
+		{
+			TRACE_ZONE("decode font");
+			// FreeType faces can be used on different threads, but opening and closing them
+			// changes the library they share
+			static std::mutex open_lock;
+			TTF_Font* font;
+			{
+				std::lock_guard<std::mutex> lock(open_lock);
+				font = TTF_OpenFontRW(SDL_RWFromConstMem(file.data, file.size), 1, desc.pt);
+			}
+			g_gamemaster->fonts[desc.type] = font;
+			timing.failed = !font || !buildGlyphAtlas(font, g_gamemaster->atlases[desc.type]);
+			break;
+		}
+		case AK_IMAGE:
+		{
+			TRACE_ZONE("decode image");
+			images[desc.type] = IMG_Load_RW(SDL_RWFromConstMem(file.data, file.size), 1);
+			timing.failed = !images[desc.type];
+			break;
+		}
+		case AK_SOUND:
+		{
+			TRACE_ZONE("decode sound");
+			sounds[desc.type] = Mix_LoadWAV_RW(SDL_RWFromConstMem(file.data, file.size), 1);
+			timing.failed = !sounds[desc.type];
+			break;
+		}
+	}
+	timing.decode_ms = msSince(start);
+}
+
+bool loadAssets(int which){
+	TRACE_ZONE("load assets");
+	Uint64 start = SDL_GetPerformanceCounter();
+	if (which & AS_FONTS){
+		TTF_Init(); // Must always be called before using SDL_ttf API
+		g_gamemaster->fonts = std::vector<TTF_Font*>(NUM_FONTS, nullptr);
+		g_gamemaster->atlases = std::vector<GlyphAtlas>(NUM_FONTS);
+	}
+
+	// Each file once, however many assets come from it
+	std::vector<size_t> todo;
+	size_t first_new = files.size();
+	for (size_t i = 0; i < NUM_ASSETS; i++){
+		if (!(which & kindFlag(ASSETS[i].kind)))
+			continue;
+		int file = -1;
+		for (size_t f = 0; f < files.size(); f++){
+			if (strcmp(files[f].path, ASSETS[i].path) == 0)
+				file = f;
+		}
+		timings[i] = AssetTiming();
+		timings[i].loaded = true;
+		timings[i].first_use = (file < 0);
+		if (file < 0){
+			file = files.size();
+			files.push_back({.path=ASSETS[i].path, .data=nullptr, .size=0, .read_ms=0, .keep=false, .owned=false});
+		}
+		files[file].keep |= (ASSETS[i].kind == AK_FONT);
+		timings[i].file = file;
+		todo.push_back(i);
+	}
+
+	#ifdef EMSCRIPTEN
+	int threads = 1; // No threads in the web build
+	#else
+	int threads = defaultThreadCount();
+	#endif
+	load_threads = std::max(load_threads, std::min(threads, (int)todo.size()));
+
+	// Straight out of the asset pack if there is one, the loose files otherwise
+	openAssetPack();
+	parallelFor(files.size() - first_new, threads, [&](size_t i, int){
+		TRACE_ZONE("read asset file");
+		AssetFile& file = files[first_new + i];
+		Uint64 read_start = SDL_GetPerformanceCounter();
+		if (!findPackedAsset(file.path, file.data, file.size)){
+			file.data = SDL_LoadFile(file.path, &file.size);
+			file.owned = true;
+		}
+		file.read_ms = msSince(read_start);
+	});
+	parallelFor(todo.size(), threads, [&](size_t i, int){
+		decodeAsset(todo[i]);
+	});
+
+	// Images and sounds are copies by now, only the fonts still read from their file
+	bool fonts_ok = true;
+	for (size_t i : todo){
+		const AssetFile& file = files[timings[i].file];
+		if (!timings[i].failed)
+			continue;
+		if (ASSETS[i].kind != AK_FONT)
+			std::cerr << "Error: Failed to load \"" << ASSETS[i].path << "\"\n";
+		else if (!file.data || !g_gamemaster->fonts[ASSETS[i].type]){
+			if (fonts_ok)
+				std::cerr << "Fatal Error: Font file \"" << FONT_PATH << "\" could not be found.\n";
+			fonts_ok = false;
+		}
+		else {
+			std::cerr << "Fatal Error: Failed to build glyph atlas: " << SDL_GetError() << "\n";
+			fonts_ok = false;
+		}
+	}
+	for (size_t f = first_new; f < files.size(); f++){
+		if (!files[f].keep && files[f].owned){
+			SDL_free((void*)files[f].data);
+			files[f].data = nullptr;
+		}
+	}
+	load_ms += msSince(start);
+	return fonts_ok;
+}
+
+SDL_Surface* takeImage(ImageType image_type){
+	SDL_Surface* surface = images[image_type];
+	images[image_type] = nullptr;
+	return surface;
+}
+
+Mix_Chunk* takeSound(SoundType sound_type){
+	Mix_Chunk* chunk = sounds[sound_type];
+	sounds[sound_type] = nullptr;
+	return chunk;
+}
+
+void freeAssetFiles(){
+	for (AssetFile& file : files){
+		if (file.owned)
+			SDL_free((void*)file.data);
+	}
+	files.clear();
+	closeAssetPack();
+}
+
+void noteImageUpload(ImageType image_type, double ms){
+	for (size_t i = 0; i < NUM_ASSETS; i++){
+		if (ASSETS[i].kind == AK_IMAGE && ASSETS[i].type == image_type)
+			timings[i].upload_ms = ms;
+	}
+}
+
+void printStartupReport(double startup_ms){
+	printf("Startup report (assets from %s):\n", assetPackSource());
+	printf("  %-36s %8s %8s %10s %10s\n", "asset", "bytes", "read ms", "decode ms", "upload ms");
+	double work_ms = 0;
+	for (size_t i = 0; i < NUM_ASSETS; i++){
+		const AssetTiming& t = timings[i];
+		if (!t.loaded)
+			continue;
+		const AssetFile& file = files.size() > (size_t)t.file ? files[t.file] : AssetFile();
+		char name[64], read[16], upload[16];
+		if (ASSETS[i].kind == AK_FONT)
+			snprintf(name, sizeof(name), "%s %dpt", ASSETS[i].path, ASSETS[i].pt);
+		else
+			snprintf(name, sizeof(name), "%s", ASSETS[i].path);
+		if (t.first_use)
+			snprintf(read, sizeof(read), "%.2f", file.read_ms);
+		else
+			snprintf(read, sizeof(read), "shared");
+		if (ASSETS[i].kind == AK_IMAGE)
+			snprintf(upload, sizeof(upload), "%.2f", t.upload_ms);
+		else
+			snprintf(upload, sizeof(upload), "-");
+		printf("  %-36s %8zu %8s %10.2f %10s%s\n", name, file.size, read, t.decode_ms, upload,
+			t.failed ? "  FAILED" : "");
+		work_ms += (t.first_use ? file.read_ms : 0) + t.decode_ms + t.upload_ms;
+	}
+	printf("  Assets: %.2f ms of work, reading and decoding took %.2f ms on %d threads\n", work_ms, load_ms, load_threads);
+	printf("  Ready to draw the first frame %.2f ms after starting\n", startup_ms);
+}
@@ -0,0 +1,29 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+// Startup asset loading. Every asset file is read once, or found in the asset pack (assetpack.h),
+// and shared by whatever is made from it (the font is opened at all three sizes from the same
+// bytes). The decoding (PNGs, WAVs, fonts and their glyph atlases) is spread over worker threads.
+// Texture uploads need the renderer, so they're all that's left for the main thread:
+// GFX::loadImages takes the decoded images from here, and SoundMaster takes the sounds.
+
+#include "graphics.h"
+
+// What loadAssets loads
+#define AS_FONTS 1
+#define AS_IMAGES 2
+#define AS_SOUNDS 4 // Needs the audio device open (initSounds)
+
+// Loads the fonts into g_gamemaster, with their glyph atlases, and decodes the images and sounds
+// for their owners to take. Returns false if the fonts failed, which is fatal. Images and sounds
+// that fail are reported and left out.
+bool loadAssets(int which);
+SDL_Surface* takeImage(ImageType image_type); // Now the caller's to free, nullptr if it didn't load
+Mix_Chunk* takeSound(SoundType sound_type); // Same
+void freeAssetFiles(); // And the asset pack. The fonts read from these as they go, close them first.
+
+// Startup report (--startup-report): how long each asset took to read, decode and upload
+void noteImageUpload(ImageType image_type, double ms);
+void printStartupReport(double startup_ms);
+
+#endif // ASSETS_H
@@ -0,0 +1,258 @@
+#include "autopilot.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+static const MoveDir ALL_DIRS[] = { M_LEFT, M_DOWN, M_RIGHT, M_UP };
+
+// Alive after a move (winning counts)
+static bool survived(StepResult res){ return res == SR_MOVED || res == SR_ATE || res == SR_WON; }
+
+void PlanStats::merge(const PlanStats& o){
+	plans += o.plans;
+	over_budget += o.over_budget;
+	for (int i = 0; i < NUM_PLAN_STAGES; i++)
+		stages[i] += o.stages[i];
+	total_us += o.total_us;
+	max_us = std::max(max_us, o.max_us);
+}
+
+AutopilotPolicy::AutopilotPolicy(int budget_us):
+	_cols(0), _rows(0), _budget(std::chrono::microseconds(budget_us)), _timed_out(false),
+	_scratch(BOARD_COLS, BOARD_ROWS), _stamp(0),
+	_last_score(0), _last_tick(0), _stall(0), _stats() {}
+
+void AutopilotPolicy::resize(int cols, int rows){
+	_cols = cols;
+	_rows = rows;
+	int cells = cols*rows;
+	if (cells > SNAPSHOT_MAX_CELLS){
+		fprintf(stderr, "Fatal error: The autopilot can't plan on a %dx%d board (%d cells at most)\n",
+			cols, rows, SNAPSHOT_MAX_CELLS);
+		exit(EXIT_FAILURE);
+	}
+	_scratch = GameCore(cols, rows);
+	_free_at.assign(cells, 0);
+	_seen.assign(cells, 0);
+	_stamp = 0;
+	_dist.assign(cells, 0);
+	_parent.assign(cells, 0);
+	_queue.assign(cells, 0);
+	_path.clear();
+	_path.reserve(cells);
+	_scratch.reserveUndo(1);
+
+	// Hamiltonian cycle: along the top row, then snake back and forth over every row but the first
+	// column, and return up the first column. Needs an even number of rows, so transpose if only the
+	// column count is even.
+	_cycle.clear();
+	bool transpose = rows%2 != 0;
+	int w = transpose ? rows : cols, h = transpose ? cols : rows;
+	if (h%2 != 0 || w < 2)
+		return; // No cycle on boards with both sides odd
+	_cycle.resize(cells);
+	for (int y = 0; y < h; y++){
+		for (int x = 0; x < w; x++){
+			MoveDir d;
+			if (x == 0)
+				d = (y == 0) ? M_RIGHT : M_UP;
+			else if (y%2 == 0)
+				d = (x == w-1) ? M_DOWN : M_RIGHT;
+			else if (x == 1)
+				d = (y == h-1) ? M_LEFT : M_DOWN;
+			else
+				d = M_LEFT;
+			if (transpose){ // Mirror across the diagonal: LEFT<->UP, RIGHT<->DOWN
+				static const MoveDir SWAP[] = { M_UP, M_RIGHT, M_DOWN, M_LEFT };
+				_cycle[x*cols+y] = SWAP[d];
+			} else {
+				_cycle[y*cols+x] = d;
+			}
+		}
+	}
+}
+
+void AutopilotPolicy::loadScratch(const GameCore& game){
+	// resize() made sure the board fits a snapshot, so this never allocates
+	game.save(_snap);
+	_scratch.restore(_snap);
+}
+
+bool AutopilotPolicy::outOfTime(){
+	if (!_timed_out && Clock::now() >= _deadline)
+		_timed_out = true;
+	return _timed_out;
+}
+
+MoveDir AutopilotPolicy::nextDir(const GameCore& game){
+	Clock::time_point start = Clock::now();
+	_deadline = start + _budget;
+	_timed_out = false;
+	if (game.cols() != _cols || game.rows() != _rows)
+		resize(game.cols(), game.rows());
+
+	if (game.score() != _last_score || game.getTick() <= _last_tick) // Ate, or a new game started
+		_stall = 0;
+	else
+		_stall++;
+	_last_score = game.score();
+	_last_tick = game.getTick();
+	bool stalled = _stall > _cols*_rows;
+
+	MoveDir dir;
+	PlanStage stage;
+	if (!outOfTime() && planFood(game, dir))
+		stage = PS_FOOD;
+	else if (stalled && !outOfTime() && planCycle(game, dir, true))
+		stage = PS_CYCLE;
+	else if (!outOfTime() && planTail(game, dir))
+		stage = PS_TAIL;
+	else if (!outOfTime() && planCycle(game, dir, false))
+		stage = PS_CYCLE;
+	else {
+		dir = planAny(game);
+		stage = PS_ANY;
+	}
+
+	double us = std::chrono::duration<double, std::micro>(Clock::now()-start).count();
+	_stats.plans++;
+	_stats.over_budget += _timed_out;
+	_stats.stages[stage]++;
+	_stats.total_us += us;
+	_stats.max_us = std::max(_stats.max_us, us);
+	_stats.last_us = us;
+	_stats.last_stage = stage;
+	return dir;
+}
+
+int AutopilotPolicy::search(const GameCore& game, int target, int extra_grow){
+	// Segment i of the body (0 is right behind the head) moves off its cell after size-i moves,
+	// plus one more for every segment still owed
+	const BodyRing& body = game.getBody();
+	int n = body.size(), grow = game.pendingGrow() + extra_grow;
+	std::fill(_free_at.begin(), _free_at.end(), 0);
+	for (int i = 0; i < n; i++)
+		_free_at[body[i]] = n-i+grow;
+
+	Cell head = game.getHead();
+	int start = head.y*_cols + head.x;
+	if (++_stamp == 0){ // Stamp wrapped around, old marks could look current again
+		std::fill(_seen.begin(), _seen.end(), 0);
+		_stamp = 1;
+	}
+	_seen[start] = _stamp;
+	_dist[start] = 0;
+	_queue[0] = start;
+	size_t qhead = 0, qtail = 1;
+	while (qhead < qtail){
+		if ((qhead & 63) == 0 && outOfTime())
+			return -1;
+		int c = _queue[qhead++];
+		if (c == target)
+			return _dist[c];
+		int d = _dist[c]+1;
+		Cell cell = game.toCell(c);
+		for (MoveDir dir : ALL_DIRS){
+			if (c == start && isReverse(dir, game.getDir()))
+				continue;
+			Cell next = moveCell(cell, dir);
+			if (next.x < 0 || next.x >= _cols || next.y < 0 || next.y >= _rows)
+				continue;
+			int ni = next.y*_cols + next.x;
+			if (_seen[ni] == _stamp || _free_at[ni] > (uint32_t)d)
+				continue;
+			_seen[ni] = _stamp;
+			_dist[ni] = d;
+			_parent[ni] = c;
+			_queue[qtail++] = ni;
+		}
+	}
+	return -1;
+}
+
+bool AutopilotPolicy::tailReachable(const GameCore& game, int extra_grow){
+	if (game.getBody().empty())
+		return true; // Just a head, nothing to get trapped by
+	return search(game, game.getBody().back(), extra_grow) >= 0;
+}
+
+bool AutopilotPolicy::planFood(const GameCore& game, MoveDir& dir){
+	Cell head = game.getHead(), food = game.getFood();
+	if (head == food)
+		return false; // Gets eaten this tick, and we don't know where the next one goes yet
+	int start = head.y*_cols + head.x, target = food.y*_cols + food.x;
+	if (search(game, target, 0) < 0)
+		return false;
+
+	// Walk back from the food to get the moves in order
+	_path.clear();
+	for (int c = target; c != start; c = _parent[c]){
+		Cell from = game.toCell(_parent[c]), to = game.toCell(c);
+		_path.push_back(to.x < from.x ? M_LEFT : to.x > from.x ? M_RIGHT : to.y > from.y ? M_DOWN : M_UP);
+	}
+	std::reverse(_path.begin(), _path.end());
+
+	// Play the path out on the scratch copy, then make sure the tail can still be reached once
+	// the food has been eaten
+	loadScratch(game);
+	for (size_t i = 0; i < _path.size(); i++){
+		if ((i & 63) == 63 && outOfTime())
+			return false;
+		if (!survived(_scratch.step(_path[i])))
+			return false;
+	}
+	if (!tailReachable(_scratch, 1))
+		return false;
+	dir = _path[0];
+	return true;
+}
+
+bool AutopilotPolicy::planTail(const GameCore& game, MoveDir& dir){
+	loadScratch(game);
+	int best = -1;
+	for (MoveDir d : ALL_DIRS){
+		if (isReverse(d, game.getDir()))
+			continue;
+		StepResult res = _scratch.pushStep(d);
+		int dist = -1;
+		if (res == SR_WON)
+			dist = _cols*_rows; // Can't beat that
+		else if (survived(res))
+			dist = _scratch.getBody().empty() ? 0 : search(_scratch, _scratch.getBody().back(), 0);
+		_scratch.popStep();
+		if (dist > best){
+			best = dist;
+			dir = d;
+		}
+		if (_timed_out)
+			break;
+	}
+	return best >= 0;
+}
+
+bool AutopilotPolicy::planCycle(const GameCore& game, MoveDir& dir, bool keep_tail){
+	if (_cycle.empty())
+		return false;
+	Cell head = game.getHead();
+	MoveDir d = (MoveDir)_cycle[head.y*_cols + head.x];
+	if (isReverse(d, game.getDir()))
+		return false;
+	loadScratch(game);
+	StepResult res = _scratch.step(d);
+	if (!survived(res) || (keep_tail && res != SR_WON && !tailReachable(_scratch, 0)))
+		return false;
+	dir = d;
+	return true;
+}
+
+MoveDir AutopilotPolicy::planAny(const GameCore& game){
+	for (MoveDir d : ALL_DIRS){
+		Cell next = moveCell(game.getHead(), d);
+		// The tail cell is fine to move into when it's about to move away
+		bool tail = !game.getBody().empty() && game.pendingGrow() == 0
+			&& game.getBody().back() == next.y*_cols + next.x;
+		if (!isReverse(d, game.getDir()) && (tail || !game.blocked(next)))
+			return d;
+	}
+	return game.getDir(); // Nothing survives
+}
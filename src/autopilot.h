@@ -0,0 +1,95 @@
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+// Pathfinding autopilot. Every tick it tries, in order:
+//   1. The shortest path to the food, from a BFS that knows which body cells will have moved out of
+//      the way by the time the head gets there. Only taken if the tail is still in reach once the
+//      food is eaten, so the snake never boxes itself in for an apple.
+//   2. Chasing its own tail, taking the move that keeps the tail furthest away, to stall until a
+//      safe path to the food opens up.
+//   3. The next move along a precomputed Hamiltonian cycle of the board (needs an even number of
+//      rows or columns, which 64x36 has). If the snake has gone a whole board's worth of ticks
+//      without eating, this is tried before tail chasing, since the cycle is sure to pass the food.
+//   4. Any move that doesn't end the game this tick.
+// Stages 1-3 stop at a hard per-tick deadline and the planner falls through to the next one, so
+// a plan never takes much longer than the budget. Planning times are kept in stats().
+
+#include <chrono>
+
+#include "policy.h"
+
+#define AUTOPILOT_BUDGET_US 1000 // Default planning budget per tick (microseconds), 6% of a 60 FPS frame
+
+// Which stage of the planner picked the move
+typedef enum PlanStage {
+	PS_FOOD,
+	PS_TAIL,
+	PS_CYCLE,
+	PS_ANY,
+} PlanStage;
+
+#define NUM_PLAN_STAGES 4
+
+struct PlanStats {
+	uint64_t plans; // Ticks planned
+	uint64_t over_budget; // Plans that hit the deadline and fell through to a cheaper stage
+	uint64_t stages[NUM_PLAN_STAGES]; // How many plans each stage decided
+	double total_us, max_us, last_us;
+	PlanStage last_stage;
+
+	double meanUs() const { return plans ? total_us/plans : 0; }
+	void merge(const PlanStats& o);
+};
+
+class AutopilotPolicy : public Policy {
+public:
+	AutopilotPolicy(int budget_us=AUTOPILOT_BUDGET_US);
+
+	MoveDir nextDir(const GameCore& game) override;
+
+	void setBudget(int budget_us){ _budget = std::chrono::microseconds(budget_us); }
+	const PlanStats& stats() const { return _stats; }
+	void resetStats(){ _stats = PlanStats(); }
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	void resize(int cols, int rows); // Size the search buffers and build the cycle for a new board
+	void loadScratch(const GameCore& game); // Copy game into _scratch through _snap
+	bool outOfTime();
+
+	// BFS over the board from the scratch game's head, stopping at target. A body cell can be entered
+	// once the tail has moved off it. Returns the number of moves to target, or -1 if it can't be
+	// reached (or time ran out). extra_grow counts segments owed on top of the game's own.
+	int search(const GameCore& game, int target, int extra_grow);
+	bool tailReachable(const GameCore& game, int extra_grow);
+
+	bool planFood(const GameCore& game, MoveDir& dir);
+	bool planTail(const GameCore& game, MoveDir& dir);
+	bool planCycle(const GameCore& game, MoveDir& dir, bool keep_tail);
+	MoveDir planAny(const GameCore& game);
+
+	int _cols, _rows;
+	Clock::duration _budget;
+	Clock::time_point _deadline;
+	bool _timed_out;
+
+	GameCore _scratch; // Copy of the game to try moves on
+	GameSnapshot _snap;
+
+	std::vector<uint32_t> _free_at; // Moves until each cell is clear of the body, 0 if it's free now
+	std::vector<uint32_t> _seen; // BFS visit stamps, cell i was reached in this search if _seen[i] == _stamp
+	uint32_t _stamp;
+	std::vector<int32_t> _dist;
+	std::vector<CellIndex> _parent, _queue;
+	std::vector<MoveDir> _path;
+	std::vector<uint8_t> _cycle; // MoveDir leaving each cell along the Hamiltonian cycle, empty if there is none
+
+	int _last_score; // Score at the previous tick, to spot stalling
+	uint64_t _last_tick;
+	int _stall; // Ticks since the snake last ate
+
+	PlanStats _stats;
+};
+
+#endif // AUTOPILOT_H
@@ -0,0 +1,241 @@
+#include "batch.h"
+
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define BATCH_LANES 8
+#define BATCH_KERNEL "AVX2"
+#elif defined(__SSE2__)
+#define BATCH_LANES 4
+#define BATCH_KERNEL "SSE2"
+#else
+#define BATCH_LANES 1
+#define BATCH_KERNEL "scalar"
+#endif
+
+// Bits in _flags written by the movement kernel
+#define BF_EAT 1
+#define BF_WALL 2
+
+BatchSim::BatchSim(int num_boards, int cols, int rows, uint64_t seed):
+	_n(num_boards), _n_padded((num_boards+BATCH_LANES-1)/BATCH_LANES*BATCH_LANES),
+	_cols(cols), _rows(rows), _cells(cols*rows), _words((cols*rows+63)/64),
+	_auto_reset(true), _scalar(false),
+	_head_x(_n_padded), _head_y(_n_padded), _head_cell(_n_padded), _dir(_n_padded),
+	_length(_n_padded), _grow(_n_padded), _food(_n_padded),
+	_act(_n_padded, M_RIGHT), _next_x(_n_padded), _next_y(_n_padded), _flags(_n_padded),
+	_done(_n_padded, 1), // Padding lanes are permanently done
+	_occ((size_t)_n*_words), _body((size_t)_n*_cells), _body_start(_n), _body_size(_n)
+{
+	_rng.reserve(_n);
+	for (int i = 0; i < _n; i++)
+		_rng.emplace_back(splitMix64(seed ^ splitMix64(i)));
+	reset();
+}
+
+void BatchSim::reset(){
+	for (int i = 0; i < _n; i++)
+		resetBoard(i);
+}
+
+void BatchSim::reset(const uint8_t* mask){
+	for (int i = 0; i < _n; i++)
+		if (mask[i])
+			resetBoard(i);
+}
+
+void BatchSim::resetBoard(int i){
+	_head_x[i] = _cols/2;
+	_head_y[i] = _rows/2;
+	_head_cell[i] = _head_y[i]*_cols + _head_x[i];
+	_dir[i] = M_RIGHT;
+	_length[i] = 1;
+	_grow[i] = 0;
+	_body_start[i] = _body_size[i] = 0;
+	std::fill(&_occ[(size_t)i*_words], &_occ[(size_t)(i+1)*_words], 0);
+	_done[i] = 0;
+	setRandFood(i);
+}
+
+bool BatchSim::setRandFood(int i){
+	int head = _head_cell[i];
+	int nfree = _cells - _body_size[i] - 1; // Everything but the body and the head
+	if (nfree <= 0)
+		return false;
+	int k = _rng[i].bounded(nfree);
+
+	// Walk the bitplane a word at a time until we reach the k-th free cell
+	const uint64_t* occ = occupancy(i);
+	for (int w = 0; w < _words; w++){
+		uint64_t free_bits = ~occ[w];
+		if (w == _words-1 && _cells%64)
+			free_bits &= (1ULL << (_cells%64))-1; // Bits past the end of the board
+		if (head/64 == w)
+			free_bits &= ~(1ULL << (head%64));
+		int count = __builtin_popcountll(free_bits);
+		if (k < count){
+			_food[i] = w*64 + selectBit(free_bits, k);
+			return true;
+		}
+		k -= count;
+	}
+	return false;
+}
+
+const char* BatchSim::kernelName() const {
+	return _scalar ? "scalar" : BATCH_KERNEL;
+}
+
+// Direction update (anti-reversal), food test, movement and wall test for every lane.
+// Opposite directions differ by exactly 2 in the MoveDir enum, so a reversal is (act ^ dir) == 2.
+// Finished lanes keep their direction, so they hold their final state until they're reset.
+static void moveKernelScalar(int n, int cols, int rows, const int32_t* act, int32_t* dir,
+		const int32_t* hx, const int32_t* hy, const int32_t* hcell, const int32_t* food, const uint8_t* done,
+		int32_t* nx, int32_t* ny, int32_t* flags){
+	for (int i = 0; i < n; i++){
+		int32_t d = (done[i] || (act[i] ^ dir[i]) == 2) ? dir[i] : act[i];
+		dir[i] = d;
+		nx[i] = hx[i] + (d == M_RIGHT) - (d == M_LEFT);
+		ny[i] = hy[i] + (d == M_DOWN) - (d == M_UP);
+		bool wall = nx[i] < 0 || nx[i] >= cols || ny[i] < 0 || ny[i] >= rows;
+		flags[i] = (hcell[i] == food[i] ? BF_EAT : 0) | (wall ? BF_WALL : 0);
+	}
+}
+
+// Same as moveKernelScalar, BATCH_LANES lanes at a time. Compare results are -1/0 masks, so
+// dx = [d==LEFT] - [d==RIGHT] comes out as -1/0/+1.
+static void moveKernel(int n, int cols, int rows, const int32_t* act, int32_t* dir,
+		const int32_t* hx, const int32_t* hy, const int32_t* hcell, const int32_t* food, const uint8_t* done,
+		int32_t* nx, int32_t* ny, int32_t* flags){
+#if defined(__AVX2__)
+	const __m256i one = _mm256_set1_epi32(1), two = _mm256_set1_epi32(2), three = _mm256_set1_epi32(3);
+	const __m256i zero = _mm256_setzero_si256(), neg1 = _mm256_set1_epi32(-1);
+	const __m256i vcols = _mm256_set1_epi32(cols), vrows = _mm256_set1_epi32(rows);
+	const __m256i feat = _mm256_set1_epi32(BF_EAT), fwall = _mm256_set1_epi32(BF_WALL);
+	for (int i = 0; i < n; i += 8){
+		__m256i a = _mm256_loadu_si256((const __m256i*)(act+i));
+		__m256i d = _mm256_loadu_si256((const __m256i*)(dir+i));
+		__m256i fin = _mm256_cmpgt_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(done+i))), zero);
+		__m256i keep = _mm256_or_si256(_mm256_cmpeq_epi32(_mm256_xor_si256(a, d), two), fin);
+		d = _mm256_blendv_epi8(a, d, keep);
+		_mm256_storeu_si256((__m256i*)(dir+i), d);
+
+		__m256i eat = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(hcell+i)),
+			_mm256_loadu_si256((const __m256i*)(food+i)));
+
+		__m256i x = _mm256_loadu_si256((const __m256i*)(hx+i));
+		__m256i y = _mm256_loadu_si256((const __m256i*)(hy+i));
+		x = _mm256_add_epi32(x, _mm256_sub_epi32(_mm256_cmpeq_epi32(d, zero), _mm256_cmpeq_epi32(d, two)));
+		y = _mm256_add_epi32(y, _mm256_sub_epi32(_mm256_cmpeq_epi32(d, three), _mm256_cmpeq_epi32(d, one)));
+		__m256i inside = _mm256_and_si256(
+			_mm256_and_si256(_mm256_cmpgt_epi32(x, neg1), _mm256_cmpgt_epi32(vcols, x)),
+			_mm256_and_si256(_mm256_cmpgt_epi32(y, neg1), _mm256_cmpgt_epi32(vrows, y)));
+		_mm256_storeu_si256((__m256i*)(nx+i), x);
+		_mm256_storeu_si256((__m256i*)(ny+i), y);
+		_mm256_storeu_si256((__m256i*)(flags+i),
+			_mm256_or_si256(_mm256_and_si256(eat, feat), _mm256_andnot_si256(inside, fwall)));
+	}
+#elif defined(__SSE2__)
+	const __m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2), three = _mm_set1_epi32(3);
+	const __m128i zero = _mm_setzero_si128(), neg1 = _mm_set1_epi32(-1);
+	const __m128i vcols = _mm_set1_epi32(cols), vrows = _mm_set1_epi32(rows);
+	const __m128i feat = _mm_set1_epi32(BF_EAT), fwall = _mm_set1_epi32(BF_WALL);
+	for (int i = 0; i < n; i += 4){
+		__m128i a = _mm_loadu_si128((const __m128i*)(act+i));
+		__m128i d = _mm_loadu_si128((const __m128i*)(dir+i));
+		int32_t done4;
+		memcpy(&done4, done+i, sizeof(done4));
+		__m128i fin = _mm_cvtsi32_si128(done4);
+		fin = _mm_cmpgt_epi32(_mm_unpacklo_epi16(_mm_unpacklo_epi8(fin, zero), zero), zero);
+		__m128i keep = _mm_or_si128(_mm_cmpeq_epi32(_mm_xor_si128(a, d), two), fin);
+		d = _mm_or_si128(_mm_and_si128(keep, d), _mm_andnot_si128(keep, a));
+		_mm_storeu_si128((__m128i*)(dir+i), d);
+
+		__m128i eat = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(hcell+i)),
+			_mm_loadu_si128((const __m128i*)(food+i)));
+
+		__m128i x = _mm_loadu_si128((const __m128i*)(hx+i));
+		__m128i y = _mm_loadu_si128((const __m128i*)(hy+i));
+		x = _mm_add_epi32(x, _mm_sub_epi32(_mm_cmpeq_epi32(d, zero), _mm_cmpeq_epi32(d, two)));
+		y = _mm_add_epi32(y, _mm_sub_epi32(_mm_cmpeq_epi32(d, three), _mm_cmpeq_epi32(d, one)));
+		__m128i inside = _mm_and_si128(
+			_mm_and_si128(_mm_cmpgt_epi32(x, neg1), _mm_cmpgt_epi32(vcols, x)),
+			_mm_and_si128(_mm_cmpgt_epi32(y, neg1), _mm_cmpgt_epi32(vrows, y)));
+		_mm_storeu_si128((__m128i*)(nx+i), x);
+		_mm_storeu_si128((__m128i*)(ny+i), y);
+		_mm_storeu_si128((__m128i*)(flags+i),
+			_mm_or_si128(_mm_and_si128(eat, feat), _mm_andnot_si128(inside, fwall)));
+	}
+#else
+	moveKernelScalar(n, cols, rows, act, dir, hx, hy, hcell, food, done, nx, ny, flags);
+#endif
+}
+
+void BatchSim::step(const int32_t* actions, uint8_t* results){
+	if (_auto_reset)
+		for (int i = 0; i < _n; i++)
+			if (_done[i])
+				resetBoard(i);
+
+	// The kernel reads whole lanes, so actions go through padded storage
+	std::copy(actions, actions+_n, _act.begin());
+	(_scalar ? moveKernelScalar : moveKernel)(_n_padded, _cols, _rows, _act.data(), _dir.data(),
+		_head_x.data(), _head_y.data(), _head_cell.data(), _food.data(), _done.data(), _next_x.data(),
+		_next_y.data(), _flags.data());
+
+	// Everything that touches per-board variable-length state (body ring, bitplane, RNG)
+	for (int i = 0; i < _n; i++){
+		if (_done[i]){
+			results[i] = SR_MOVED;
+			continue;
+		}
+		StepResult res = SR_MOVED;
+
+		// Eat events (same as GameCore::doStep)
+		if (_flags[i] & BF_EAT){
+			_length[i]++;
+			_grow[i]++;
+			res = SR_ATE;
+			if (!setRandFood(i)){
+				_done[i] = 1;
+				results[i] = SR_WON;
+				continue;
+			}
+		}
+
+		// Movement
+		if (_flags[i] & BF_WALL){
+			_done[i] = 1;
+			results[i] = SR_HIT_WALL;
+			continue;
+		}
+		CellIndex* ring = &_body[(size_t)i*_cells];
+		if (_grow[i] > 0){
+			_grow[i]--;
+		} else if (_body_size[i] > 0){
+			int back = _body_start[i] + _body_size[i]-1;
+			clearBit(i, ring[back >= _cells ? back-_cells : back]);
+			_body_size[i]--;
+		}
+		if (_length[i] >= 2){
+			_body_start[i] = (_body_start[i] == 0) ? _cells-1 : _body_start[i]-1;
+			ring[_body_start[i]] = _head_cell[i];
+			setBit(i, _head_cell[i]);
+			_body_size[i]++;
+		}
+		_head_x[i] = _next_x[i];
+		_head_y[i] = _next_y[i];
+		_head_cell[i] = _head_y[i]*_cols + _head_x[i];
+
+		// Self collision
+		if (testBit(i, _head_cell[i])){
+			_done[i] = 1;
+			res = SR_HIT_SELF;
+		}
+		results[i] = res;
+	}
+}
@@ -0,0 +1,67 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+// Steps many boards in lockstep for bot training. Same rules as GameCore, but the state is
+// laid out as structure-of-arrays so movement, wall and food tests run as SIMD kernels
+// (AVX2 if built with -mavx2, otherwise SSE2, otherwise plain scalar code).
+
+#include "core.h"
+
+class BatchSim {
+public:
+	BatchSim(int num_boards, int cols=BOARD_COLS, int rows=BOARD_ROWS, uint64_t seed=0);
+
+	// Runs one tick on every board that isn't done. actions[i] is the MoveDir for board i
+	// (180 degree turns are ignored, like GameCore::setBuffDir). results[i] gets that board's StepResult.
+	// Boards that end this tick are flagged in done(). With auto reset on, they restart at the
+	// start of the next step() call, so their final state can still be read in between. With it
+	// off, they keep their final state until they're reset.
+	void step(const int32_t* actions, uint8_t* results);
+
+	void reset(); // Restart every board
+	void reset(const uint8_t* mask); // Restart boards whose mask entry is non-zero
+	void setAutoReset(bool on){ _auto_reset = on; }
+	// Run the plain scalar kernel even if a SIMD one is built in, to check one against the other
+	void useScalarKernel(bool on){ _scalar = on; }
+	const char* kernelName() const; // "AVX2", "SSE2" or "scalar", whichever step() runs
+
+	int size() const { return _n; }
+	int cols() const { return _cols; }
+	int rows() const { return _rows; }
+
+	// Per-board state, each array has size() entries
+	const int32_t* headX() const { return _head_x.data(); }
+	const int32_t* headY() const { return _head_y.data(); }
+	const int32_t* dirs() const { return _dir.data(); }
+	const int32_t* lengths() const { return _length.data(); }
+	const int32_t* foods() const { return _food.data(); } // Packed cell index (y*cols+x)
+	const uint8_t* done() const { return _done.data(); }
+
+	// Occupancy bitplane of board i (bit y*cols+x is set if the body covers that cell, head excluded)
+	const uint64_t* occupancy(int i) const { return &_occ[(size_t)i*_words]; }
+	int wordsPerBoard() const { return _words; }
+
+private:
+	void resetBoard(int i);
+	bool setRandFood(int i); // Returns false if the board is full
+	bool testBit(int i, int cell) const { return (_occ[(size_t)i*_words + cell/64] >> (cell%64)) & 1; }
+	void setBit(int i, int cell){ _occ[(size_t)i*_words + cell/64] |= 1ULL << (cell%64); }
+	void clearBit(int i, int cell){ _occ[(size_t)i*_words + cell/64] &= ~(1ULL << (cell%64)); }
+
+	int _n, _n_padded; // Arrays are padded to a whole number of SIMD lanes
+	int _cols, _rows, _cells, _words;
+	bool _auto_reset, _scalar;
+
+	std::vector<int32_t> _head_x, _head_y, _head_cell, _dir, _length, _grow, _food;
+	std::vector<int32_t> _act; // Padded copy of the actions passed to step()
+	std::vector<int32_t> _next_x, _next_y, _flags; // Kernel output, consumed by the scalar pass
+	std::vector<uint8_t> _done;
+
+	std::vector<uint64_t> _occ; // _words bitplane words per board
+	std::vector<CellIndex> _body; // One ring of _cells entries per board, front is behind the head
+	std::vector<int32_t> _body_start, _body_size;
+
+	std::vector<Rng> _rng;
+};
+
+#endif // BATCH_H
@@ -0,0 +1,340 @@
+#include "core.h"
+#include "geometry.h"
+
+OccupancyGrid::OccupancyGrid(int cols, int rows):
+	_cols(cols), _rows(rows),
+	_bits((cols*rows + 64*OCC_BLOCK_WORDS-1)/(64*OCC_BLOCK_WORDS)*OCC_BLOCK_WORDS),
+	_block_free(_bits.size()/OCC_BLOCK_WORDS) { clear(); }
+
+void OccupancyGrid::clear(){
+	// Bits past the end of the board, up to the end of the last block, stay set so they're never free
+	int cells = _cols*_rows;
+	std::fill(_bits.begin(), _bits.end(), ~0ULL);
+	std::fill(_bits.begin(), _bits.begin() + cells/64, 0);
+	if (cells%64)
+		_bits[cells/64] = ~0ULL << (cells%64);
+	_num_free = cells;
+	for (size_t b = 0; b < _block_free.size(); b++)
+		_block_free[b] = std::max(0, std::min(64*OCC_BLOCK_WORDS, cells - (int)b*64*OCC_BLOCK_WORDS));
+}
+
+bool OccupancyGrid::pickFree(Rng& rng, int ex_x, int ex_y, int& x, int& y) const {
+	int i;
+	if (!pickFree(rng, inBounds(ex_x, ex_y) ? ex_y*_cols+ex_x : -1, i))
+		return false;
+	x = i % _cols;
+	y = i / _cols;
+	return true;
+}
+
+bool OccupancyGrid::pickFree(Rng& rng, int exclude, int& i) const {
+	int ex = (exclude >= 0 && !test(exclude)) ? exclude : -1;
+	int n = _num_free - (ex >= 0);
+	if (n <= 0)
+		return false;
+	int k = rng.bounded(n);
+	// The k-th free cell other than ex (same as BatchSim)
+	i = nthFree(k);
+	if (ex >= 0 && i >= ex)
+		i = nthFree(k+1);
+	return true;
+}
+
+// Both loops run to the end rather than stopping at the k-th cell, so there's no branch to mispredict
+int OccupancyGrid::nthFree(int k) const {
+	int block = 0, seen = 0, total = 0;
+	for (size_t b = 0; b < _block_free.size(); b++){
+		total += _block_free[b];
+		seen += total <= k ? _block_free[b] : 0;
+		block += total <= k;
+	}
+	k -= seen;
+	const uint64_t* words = &_bits[block*OCC_BLOCK_WORDS];
+	int w = 0;
+	seen = total = 0;
+	for (int j = 0; j < OCC_BLOCK_WORDS; j++){
+		int count = __builtin_popcountll(~words[j]);
+		total += count;
+		seen += total <= k ? count : 0;
+		w += total <= k;
+	}
+	return (block*OCC_BLOCK_WORDS + w)*64 + selectBit(~words[w], k - seen);
+}
+
+GameCore::GameCore(int cols, int rows, uint64_t seed):
+	_cols(cols), _rows(rows), _body(cols*rows), _grid(cols, rows), _rng(seed)
+{
+	_step_fn = withBoardGeometry(cols, rows, [](auto geo){ return &GameCore::doStep<decltype(geo)>; });
+	reset();
+}
+
+void GameCore::reset(){
+	_head = {.x=_cols/2, .y=_rows/2};
+	_body.clear();
+	_grid.clear();
+	_dir = _buff_dir = M_RIGHT;
+	_length = 1;
+	_grow = 0;
+	_game_over = false;
+	_death = SR_MOVED;
+	_tick = 0;
+	setRandFood(AnyBoard(_cols, _rows));
+}
+
+void GameCore::setBuffDir(MoveDir new_dir){
+	switch(new_dir){
+		case M_LEFT:
+			if (_dir != M_RIGHT)
+				_buff_dir = M_LEFT;
+			break;
+		case M_DOWN:
+			if (_dir != M_UP)
+				_buff_dir = M_DOWN;
+			break;
+		case M_RIGHT:
+			if (_dir != M_LEFT)
+				_buff_dir = M_RIGHT;
+			break;
+		case M_UP:
+			if (_dir != M_DOWN)
+				_buff_dir = M_UP;
+			break;
+	}
+}
+
+StepResult GameCore::step(MoveDir new_dir){
+	setBuffDir(new_dir);
+	return step();
+}
+
+StepResult GameCore::step(){
+	return (this->*_step_fn)(nullptr);
+}
+
+StepResult GameCore::pushStep(MoveDir new_dir){
+	_undo.emplace_back();
+	StepDelta& d = _undo.back();
+	d.tick = _tick;
+	d.rng = _rng;
+	d.length = _length;
+	d.grow = _grow;
+	d.head = _head;
+	d.food = _food;
+	d.dir = _dir;
+	d.buff_dir = _buff_dir;
+	d.game_over = _game_over;
+	d.death = _death;
+	d.flags = 0;
+	setBuffDir(new_dir);
+	return (this->*_step_fn)(&d);
+}
+
+bool GameCore::popStep(){
+	if (_undo.empty())
+		return false;
+	const StepDelta& d = _undo.back();
+	// Reverse order of doStep: the front was pushed after the tail was popped
+	if (d.flags & STEP_PUSHED_FRONT){
+		_grid.remove(_body.front());
+		_body.pop_front();
+	}
+	if (d.flags & STEP_POPPED_TAIL){
+		_body.push_back(d.tail);
+		_grid.add(d.tail);
+	}
+	_tick = d.tick;
+	_rng = d.rng;
+	_length = d.length;
+	_grow = d.grow;
+	_head = d.head;
+	_food = d.food;
+	_dir = (MoveDir)d.dir;
+	_buff_dir = (MoveDir)d.buff_dir;
+	_game_over = d.game_over;
+	_death = (StepResult)d.death;
+	_undo.pop_back();
+	return true;
+}
+
+template<class Geo>
+StepResult GameCore::doStep(StepDelta* delta){
+	const Geo geo(_cols, _rows);
+	if (_game_over)
+		return _death;
+
+	StepResult res = SR_MOVED;
+	_dir = _buff_dir;
+	_tick++;
+
+	// Eat events
+	if (_head == _food){
+		_length++;
+		_grow++;
+		res = SR_ATE;
+		if (!setRandFood(geo)){
+			_game_over = true;
+			return _death = SR_WON;
+		}
+	}
+
+	// Movement
+	Cell prev = _head;
+	_head = moveCell(_head, _dir);
+	if (!geo.inBounds(_head.x, _head.y)){
+		_game_over = true;
+		return _death = SR_HIT_WALL;
+	}
+
+	if (_grow > 0){
+		_grow--;
+	} else if (!_body.empty()){
+		if (delta){
+			delta->tail = _body.back();
+			delta->flags |= STEP_POPPED_TAIL;
+		}
+		_grid.remove(_body.back());
+		_body.pop_back();
+	}
+	if (_length >= 2){
+		_body.push_front(geo.index(prev.x, prev.y));
+		_grid.add(_body.front());
+		if (delta)
+			delta->flags |= STEP_PUSHED_FRONT;
+	}
+
+	// Self collision
+	if (_grid.occupied((CellIndex)geo.index(_head.x, _head.y))){
+		_game_over = true;
+		return _death = SR_HIT_SELF;
+	}
+	return res;
+}
+
+#define CORE_STATE_HEADER 30 // Bytes before the body cells in a serialized GameCore
+
+void GameCore::serialize(std::vector<uint8_t>& out) const {
+	put16(out, _cols);
+	put16(out, _rows);
+	put32(out, _tick);
+	put32(out, _tick >> 32);
+	put16(out, _length);
+	put16(out, _grow);
+	out.push_back(_dir);
+	out.push_back(_buff_dir);
+	out.push_back(_game_over);
+	out.push_back(_death);
+	put16(out, _head.x);
+	put16(out, _head.y);
+	put16(out, _food.x);
+	put16(out, _food.y);
+	put16(out, _body.size());
+	for (size_t i = 0; i < _body.size(); i++)
+		put16(out, _body[i]);
+}
+
+bool GameCore::deserialize(const uint8_t* data, size_t size){
+	if (size < CORE_STATE_HEADER || get16(data) != _cols || get16(data+2) != _rows)
+		return false;
+	size_t body_size = get16(data+28);
+	if (body_size > _body.capacity() || size < CORE_STATE_HEADER + body_size*2)
+		return false;
+
+	// Check everything before touching the game, so a bad keyframe leaves it as it was
+	int cells = _cols*_rows;
+	int length = get16(data+12), grow = get16(data+14);
+	uint8_t dir = data[16], buff_dir = data[17], game_over = data[18], death = data[19];
+	Cell head = {.x=(int16_t)get16(data+20), .y=(int16_t)get16(data+22)};
+	Cell food = {.x=(int16_t)get16(data+24), .y=(int16_t)get16(data+26)};
+	if (dir > M_UP || buff_dir > M_UP || game_over > 1 || death > SR_WON)
+		return false;
+	if (length < 1 || length > cells || (size_t)length != body_size + grow + 1)
+		return false;
+	if (!_grid.inBounds(food.x, food.y))
+		return false;
+	// The head only leaves the board on the tick it hits the wall
+	if (!_grid.inBounds(head.x, head.y)){
+		Cell back = moveCell(head, (MoveDir)((dir+2)%4));
+		if (!game_over || death != SR_HIT_WALL || !_grid.inBounds(back.x, back.y))
+			return false;
+	}
+	// Body cells have to be on the board, each one once
+	_grid.clear();
+	bool ok = true;
+	for (size_t i = 0; i < body_size && ok; i++){
+		CellIndex c = get16(data + CORE_STATE_HEADER + i*2);
+		ok = c < cells && !_grid.occupied(c);
+		if (ok)
+			_grid.add(c);
+	}
+	if (!ok){
+		_grid.clear();
+		for (size_t i = 0; i < _body.size(); i++)
+			_grid.add(_body[i]);
+		return false;
+	}
+
+	_tick = get32(data+4) | ((uint64_t)get32(data+8) << 32);
+	_length = length;
+	_grow = grow;
+	_dir = (MoveDir)dir;
+	_buff_dir = (MoveDir)buff_dir;
+	_game_over = game_over;
+	_death = (StepResult)death;
+	_head = head;
+	_food = food;
+	_body.clear();
+	// Cells are stored front to back, so push them back to front
+	for (size_t i = body_size; i > 0; i--)
+		_body.push_front(get16(data + CORE_STATE_HEADER + (i-1)*2));
+	return true;
+}
+
+bool GameCore::save(GameSnapshot& snap) const {
+	if (_cols*_rows > SNAPSHOT_MAX_CELLS)
+		return false;
+	snap.tick = _tick;
+	snap.rng = _rng;
+	snap.cols = _cols;
+	snap.rows = _rows;
+	snap.length = _length;
+	snap.grow = _grow;
+	snap.head = _head;
+	snap.food = _food;
+	snap.dir = _dir;
+	snap.buff_dir = _buff_dir;
+	snap.game_over = _game_over;
+	snap.death = _death;
+	snap.body_size = _body.size();
+	_body.copyTo(snap.body);
+	return true;
+}
+
+bool GameCore::restore(const GameSnapshot& snap){
+	if (snap.cols != _cols || snap.rows != _rows)
+		return false;
+	_tick = snap.tick;
+	_rng = snap.rng;
+	_length = snap.length;
+	_grow = snap.grow;
+	_head = snap.head;
+	_food = snap.food;
+	_dir = (MoveDir)snap.dir;
+	_buff_dir = (MoveDir)snap.buff_dir;
+	_game_over = snap.game_over;
+	_death = (StepResult)snap.death;
+	_body.assign(snap.body, snap.body_size);
+	_grid.clear();
+	for (size_t i = 0; i < snap.body_size; i++)
+		_grid.add(snap.body[i]);
+	_undo.clear();
+	return true;
+}
+
+template<class Geo>
+bool GameCore::setRandFood(const Geo& geo){
+	int i;
+	if (!_grid.pickFree(_rng, geo.inBounds(_head.x, _head.y) ? geo.index(_head.x, _head.y) : -1, i))
+		return false;
+	_food = {.x=geo.x(i), .y=geo.y(i)};
+	return true;
+}
@@ -0,0 +1,304 @@
+#ifndef CORE_H
+#define CORE_H
+
+// Headless game rules. Nothing in here may include SDL or touch g_gamemaster/g_soundmaster,
+// so a process can hold as many independent games as it wants (bots, regression sims, etc.)
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+#include "rng.h"
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+// To ensure grid contains only full squares, GRID_CELL_SIZE must divide evenly into
+// both SCREEN_W and SCREEN_H
+#define SCREEN_W 1280
+#define SCREEN_H 720
+#define GRID_CELL_SIZE 20
+
+// Board dimensions in cells
+#define BOARD_COLS (SCREEN_W/GRID_CELL_SIZE)
+#define BOARD_ROWS (SCREEN_H/GRID_CELL_SIZE)
+
+typedef enum MoveDir {
+	M_LEFT,
+	M_DOWN,
+	M_RIGHT,
+	M_UP,
+} MoveDir;
+
+// Outcome of a single game tick
+typedef enum StepResult {
+	SR_MOVED, // Nothing special happened
+	SR_ATE, // Snake ate the food this tick
+	SR_HIT_WALL, // Game over, snake left the board
+	SR_HIT_SELF, // Game over, snake ran into its own body
+	SR_WON, // Game over, snake fills the whole board so there is nowhere left to put food
+} StepResult;
+
+// Position on the board in grid cells (not pixels)
+struct Cell {
+	int x, y;
+	bool operator==(const Cell& o) const { return x == o.x && y == o.y; }
+	bool operator!=(const Cell& o) const { return !(*this == o); }
+};
+
+// Little-endian helpers for the binary formats (GameCore keyframes, replay files)
+inline void put16(std::vector<uint8_t>& out, uint16_t v){ out.push_back(v); out.push_back(v >> 8); }
+inline void put32(std::vector<uint8_t>& out, uint32_t v){ put16(out, v); put16(out, v >> 16); }
+inline uint16_t get16(const uint8_t* p){ return p[0] | (p[1] << 8); }
+inline uint32_t get32(const uint8_t* p){ return get16(p) | ((uint32_t)get16(p+2) << 16); }
+
+// The neighbouring cell in direction dir
+inline Cell moveCell(Cell c, MoveDir dir){
+	switch (dir){
+		case M_LEFT: c.x--; break;
+		case M_DOWN: c.y++; break;
+		case M_RIGHT: c.x++; break;
+		case M_UP: c.y--; break;
+	}
+	return c;
+}
+
+// True if a and b point in opposite directions (LEFT/RIGHT and DOWN/UP are 2 apart in the enum)
+inline bool isReverse(MoveDir a, MoveDir b){ return (a ^ b) == 2; }
+
+// Packed cell position (y*cols+x). 16 bits covers boards up to 65535 cells.
+typedef uint16_t CellIndex;
+
+// Fixed-capacity ring buffer of packed cells, front() is the segment right behind the head.
+// All storage is allocated up front, so pushing and popping during a game never allocates.
+class BodyRing {
+public:
+	BodyRing(size_t capacity): _cells(capacity), _start(0), _size(0){}
+
+	size_t size() const { return _size; }
+	bool empty() const { return _size == 0; }
+	size_t capacity() const { return _cells.size(); }
+	void clear(){ _start = _size = 0; }
+
+	CellIndex operator[](size_t i) const { return _cells[wrap(_start+i)]; }
+	CellIndex front() const { return _cells[_start]; }
+	CellIndex back() const { return (*this)[_size-1]; }
+
+	void push_front(CellIndex c){
+		_start = (_start == 0) ? _cells.size()-1 : _start-1;
+		_cells[_start] = c;
+		_size++;
+	}
+	void pop_back(){ _size--; }
+	void push_back(CellIndex c){
+		_cells[wrap(_start+_size)] = c;
+		_size++;
+	}
+	void pop_front(){
+		_start = wrap(_start+1);
+		_size--;
+	}
+
+	// Copy the cells out front to back, or replace the contents with n cells given front to back
+	void copyTo(CellIndex* out) const {
+		size_t first = std::min(_size, _cells.size()-_start);
+		std::copy(&_cells[_start], &_cells[_start]+first, out);
+		std::copy(&_cells[0], &_cells[0]+(_size-first), out+first);
+	}
+	void assign(const CellIndex* cells, size_t n){
+		std::copy(cells, cells+n, &_cells[0]);
+		_start = 0;
+		_size = n;
+	}
+
+private:
+	size_t wrap(size_t i) const { return (i >= _cells.size()) ? i-_cells.size() : i; }
+
+	std::vector<CellIndex> _cells;
+	size_t _start, _size;
+};
+
+// Position of the k-th (from 0) set bit of x, which must have more than k set bits. Constant time:
+// pdep with BMI2, otherwise byte counts summed in one multiply and a table for the last byte.
+struct SelectInByte {
+	uint8_t pos[8][256]; // pos[k][b]: the k-th set bit of byte b
+	constexpr SelectInByte(): pos(){
+		for (int b = 0; b < 256; b++)
+			for (int bit = 0, k = 0; bit < 8; bit++)
+				if (b & (1 << bit))
+					pos[k++][b] = bit;
+	}
+};
+inline constexpr SelectInByte SELECT_IN_BYTE;
+
+inline int selectBit(uint64_t x, int k){
+#ifdef __BMI2__
+	return __builtin_ctzll(_pdep_u64(1ULL << k, x));
+#else
+	const uint64_t ONES = 0x0101010101010101ULL, HIGHS = 0x8080808080808080ULL;
+	uint64_t s = x - ((x >> 1) & 0x5555555555555555ULL);
+	s = (s & 0x3333333333333333ULL) + ((s >> 2) & 0x3333333333333333ULL);
+	s = (s + (s >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	uint64_t sums = s*ONES; // Byte i is the number of set bits in bytes 0..i
+	// The bit is in the first byte whose running count passes k
+	int byte = __builtin_popcountll(((k*ONES | HIGHS) - sums) & HIGHS);
+	int before = byte ? (sums >> (byte*8 - 8)) & 0xFF : 0;
+	return byte*8 + SELECT_IN_BYTE.pos[k - before][(x >> (byte*8)) & 0xFF];
+#endif
+}
+
+// One bit per board cell, set where the snake's body is, so "is this cell taken?" is a single lookup
+// instead of a walk over the whole body. A body never covers a cell twice.
+// Food is placed as the k-th free cell for one uniform draw k, so the result only depends on which
+// cells are taken and the RNG, never on the order they were taken in. That keeps a game restored
+// from a snapshot on exactly the same course as the original, which an order-dependent free list
+// (swap-remove) can't. Free cells are also counted per block of OCC_BLOCK_WORDS words, kept up to
+// date by add/remove, so pickFree skips whole blocks, counts at most OCC_BLOCK_WORDS words in the
+// block the cell is in, then finds the bit with selectBit. That's cells/512 + 8 reads at most
+// (18 + 8 on 128x72) rather than O(1), see snake++-bench.
+#define OCC_BLOCK_WORDS 8
+
+class OccupancyGrid {
+public:
+	OccupancyGrid(int cols=BOARD_COLS, int rows=BOARD_ROWS);
+
+	bool inBounds(int x, int y) const { return x >= 0 && x < _cols && y >= 0 && y < _rows; }
+	// Cells outside the board are never occupied
+	bool occupied(int x, int y) const { return inBounds(x, y) && test(y*_cols+x); }
+	bool occupied(CellIndex i) const { return test(i); } // i must be on the board
+	void add(CellIndex i){ _bits[i/64] |= 1ULL << (i%64); _num_free--; _block_free[i/(64*OCC_BLOCK_WORDS)]--; }
+	void remove(CellIndex i){ _bits[i/64] &= ~(1ULL << (i%64)); _num_free++; _block_free[i/(64*OCC_BLOCK_WORDS)]++; }
+	void clear();
+
+	int numFree() const { return _num_free; }
+	// Picks a free cell with one draw from rng, never returning the cell (ex_x, ex_y) (e.g. the head).
+	// Returns false if there is no such cell, meaning the snake fills the whole board.
+	bool pickFree(Rng& rng, int ex_x, int ex_y, int& x, int& y) const;
+	// Same, with packed cells. Pass exclude=-1 to allow every free cell.
+	bool pickFree(Rng& rng, int exclude, int& i) const;
+
+private:
+	bool test(int i) const { return (_bits[i/64] >> (i%64)) & 1; }
+	int nthFree(int k) const; // The k-th free cell, k < _num_free
+
+	int _cols, _rows, _num_free;
+	std::vector<uint64_t> _bits;
+	std::vector<int32_t> _block_free; // Free cells in each block of OCC_BLOCK_WORDS words
+};
+
+// Biggest board (in cells) a GameSnapshot can hold, the large 128x72 board. geometry.h checks it
+// against LargeBoard.
+#define SNAPSHOT_MAX_CELLS (128*72)
+
+// Plain copy of everything GameCore::step reads or writes, RNG included, so a restored game carries
+// on exactly like the original did. Trivially copyable, so search code can keep arrays of them.
+// GameCore::save()/restore() only touch the first body_size entries of body.
+struct GameSnapshot {
+	uint64_t tick;
+	Rng rng;
+	uint16_t cols, rows;
+	int32_t length, grow;
+	Cell head, food;
+	uint8_t dir, buff_dir, game_over, death;
+	uint16_t body_size;
+	CellIndex body[SNAPSHOT_MAX_CELLS]; // Front (right behind the head) first
+};
+static_assert(std::is_trivially_copyable<GameSnapshot>::value, "GameSnapshot must stay memcpy-able");
+
+// Bits in StepDelta::flags
+#define STEP_POPPED_TAIL 1
+#define STEP_PUSHED_FRONT 2
+
+// What a single GameCore::pushStep() changed, enough to take it back without copying the board
+struct StepDelta {
+	uint64_t tick;
+	Rng rng;
+	int32_t length, grow;
+	Cell head, food;
+	uint8_t dir, buff_dir, game_over, death;
+	uint8_t flags;
+	CellIndex tail; // Cell popped off the back of the body, if STEP_POPPED_TAIL is set
+};
+
+// Self-contained game state, and the one implementation of the rules: the SDL game's simulation,
+// replays, the autopilot and tournaments all step one of these. A tick eats, moves, then checks for
+// self collision.
+// The tick is compiled once per preset board size in geometry.h, the constructor picks the one
+// that matches (or the generic version for other sizes).
+class GameCore {
+public:
+	GameCore(int cols=BOARD_COLS, int rows=BOARD_ROWS, uint64_t seed=0);
+
+	void reset(); // Start a new game on the same board
+	void setSeed(uint64_t seed){ _rng.setSeed(seed); } // Reseed food placement, takes effect from the next reset()
+
+	// Buffer the direction for the next tick. Turning straight back is ignored.
+	void setBuffDir(MoveDir new_dir);
+	// Buffer new_dir and run one tick with it. Does nothing once the game is over.
+	StepResult step(MoveDir new_dir);
+	// Run one tick with whatever direction is currently buffered
+	StepResult step();
+
+	// Same as step(new_dir), but remembers what changed so popStep() can take it back in O(1).
+	// Meant for tree search: step down a line of play, then pop back up without copying anything.
+	StepResult pushStep(MoveDir new_dir);
+	bool popStep(); // Undo the latest pushStep(). Returns false if there is nothing to undo.
+	size_t undoDepth() const { return _undo.size(); }
+	void reserveUndo(size_t depth){ _undo.reserve(depth); } // So pushStep() never allocates
+
+	Cell getHead() const { return _head; }
+	const BodyRing& getBody() const { return _body; } // Rest of the snake, excluding the head
+	Cell toCell(CellIndex i) const { return {.x=i%_cols, .y=i/_cols}; }
+	Cell getFood() const { return _food; }
+	MoveDir getDir() const { return _dir; }
+	size_t length() const { return _length; }
+	int pendingGrow() const { return _grow; } // Moves left before the tail starts following again
+	int score() const { return _length-1; }
+	bool isGameOver() const { return _game_over; }
+	uint64_t getTick() const { return _tick; }
+	int cols() const { return _cols; }
+	int rows() const { return _rows; }
+	// True if moving the head onto c would end the game (off the board or onto the body)
+	bool blocked(Cell c) const { return !_grid.inBounds(c.x, c.y) || _grid.occupied(c.x, c.y); }
+
+	// Put the food somewhere specific instead of where the RNG wanted it (replays log every spawn)
+	void setFood(Cell c){ _food = c; }
+
+	// Compact binary encoding of the board state (snake, food, directions, tick), used for replay
+	// keyframes. The RNG is not included, replays drive food placement from their own log.
+	void serialize(std::vector<uint8_t>& out) const;
+	// Returns false, leaving the game as it was, if data doesn't fit this board or isn't a state the
+	// rules could have reached (cells off the board, bad enum values, a body that doesn't add up)
+	bool deserialize(const uint8_t* data, size_t size);
+
+	// Full state copy for search (copies a few KB at most, never allocates). Unlike serialize() this
+	// includes the RNG, so the game continues with the same food as it would have.
+	// save() returns false if the board is bigger than SNAPSHOT_MAX_CELLS. restore() returns false
+	// if snap is from a different board size, and clears the pushStep() undo history.
+	bool save(GameSnapshot& snap) const;
+	bool restore(const GameSnapshot& snap);
+
+private:
+	template<class Geo> bool setRandFood(const Geo& geo); // Returns false if the board is full
+	// step(), also filling in delta if it isn't null
+	template<class Geo> StepResult doStep(StepDelta* delta);
+
+	int _cols, _rows;
+	StepResult (GameCore::*_step_fn)(StepDelta*); // doStep for this board's geometry
+	int _length;
+	int _grow; // Segments still owed from eating, the tail stays put while this is > 0
+	MoveDir _buff_dir, _dir;
+	Cell _head;
+	BodyRing _body;
+	OccupancyGrid _grid; // Cells covered by _body (not the head)
+	Cell _food;
+	bool _game_over;
+	StepResult _death; // How the game ended, returned by every step() after game over
+	uint64_t _tick;
+	Rng _rng; // Per-game generator so instances never share state
+	std::vector<StepDelta> _undo; // pushStep() history
+};
+
+#endif // CORE_H
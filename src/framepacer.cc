@@ -0,0 +1,95 @@
+#include "framepacer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+FramePacer::FramePacer(double fps): _freq(SDL_GetPerformanceFrequency()), _next(0), _last_frame(0),
+	_spin_us(FRAME_SPIN_US), _vsync(VS_OFF), _hist(), _frames(0), _max_us(0){
+	setFps(fps);
+}
+
+void FramePacer::setFps(double fps){
+	_period = (Uint64)(_freq/fps);
+}
+
+void FramePacer::wait(){
+	TRACE_ZONE("frame wait");
+	Uint64 now = SDL_GetPerformanceCounter();
+	if (_vsync != VS_OFF || _next == 0){
+		_next = now + _period;
+		return;
+	}
+
+	if (now < _next){
+		// Sleep through most of the wait, then measure how far past the requested time the sleep ran.
+		// The spin margin follows the worst recent overshoot, and slowly shrinks back when sleeps are accurate.
+		double left_us = (_next - now)*1e6/_freq;
+		if (left_us > _spin_us){
+			Uint32 sleep_ms = (Uint32)((left_us - _spin_us)/1000);
+			if (sleep_ms > 0){
+				Uint64 before = SDL_GetPerformanceCounter();
+				SDL_Delay(sleep_ms);
+				double over_us = (SDL_GetPerformanceCounter() - before)*1e6/_freq - sleep_ms*1000.0;
+				if (over_us > _spin_us)
+					_spin_us = std::min(over_us, _period*1e6/_freq);
+				else
+					_spin_us = std::max((double)FRAME_SPIN_US/2, _spin_us - (_spin_us - over_us)/16);
+			}
+		}
+		while (SDL_GetPerformanceCounter() < _next)
+			std::this_thread::yield();
+		now = _next;
+	}
+
+	// Keep to the schedule if this frame was a little late, but don't try to catch up on frames
+	// that were missed altogether (a stall, a dragged window) by rushing the next few out
+	_next += _period;
+	if (_next < now)
+		_next = now + _period;
+}
+
+void FramePacer::frameDone(){
+	Uint64 now = SDL_GetPerformanceCounter();
+	if (_last_frame){
+		double us = (now - _last_frame)*1e6/_freq;
+		_hist[std::min((int)(us/FRAME_HIST_BUCKET_US), FRAME_HIST_BUCKETS-1)]++;
+		_max_us = std::max(_max_us, us);
+		_frames++;
+	}
+	_last_frame = now;
+}
+
+double FramePacer::percentileMs(double p) const {
+	if (_frames == 0)
+		return 0;
+	uint64_t target = (uint64_t)(p*(_frames-1)), seen = 0;
+	for (int i = 0; i < FRAME_HIST_BUCKETS; i++){
+		seen += _hist[i];
+		if (seen > target)
+			return (i+1)*FRAME_HIST_BUCKET_US/1000.0; // Upper edge of the bucket
+	}
+	return maxMs();
+}
+
+void FramePacer::printReport() const {
+	if (_frames == 0)
+		return;
+	printf("Frame times over %llu frames: p50 %.1f ms, p99 %.1f ms, max %.1f ms%s\n",
+		(unsigned long long)_frames, percentileMs(0.5), percentileMs(0.99), maxMs(),
+		_vsync == VS_ADAPTIVE ? " (adaptive vsync)" : _vsync == VS_ON ? " (vsync)" : "");
+}
+
+bool FramePacer::writeHistogram(const std::string& path) const {
+	std::ofstream out(path);
+	if (!out){
+		std::cerr << "File Error: Could not write frame time histogram to \"" << path << "\"\n";
+		return false;
+	}
+	out << "frame_ms,frames\n";
+	for (int i = 0; i < FRAME_HIST_BUCKETS; i++)
+		if (_hist[i])
+			out << i*FRAME_HIST_BUCKET_US/1000.0 << "," << _hist[i] << "\n";
+	return true;
+}
@@ -0,0 +1,61 @@
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+// Frame rate limiter on the performance counter. Each frame is scheduled one period after the last;
+// wait() sleeps until shortly before that and spins the rest of the way, since SDL_Delay can
+// oversleep by a millisecond or more (much more on coarse system timers). How much to spin adapts
+// to how late the sleeps actually come back. With vsync the present call does the waiting instead.
+// Adaptive vsync waits for the display the same way, but presents a late frame straight away
+// (it tears) instead of holding it to the next refresh.
+//
+// Either way, the time between presented frames goes into a histogram for reporting p50/p99/max.
+
+#include <SDL2/SDL.h>
+
+#include "trace.h"
+
+#include <array>
+#include <string>
+
+#define FRAME_SPIN_US 2000 // Starting spin margin before a frame is due, adjusted as sleeps are measured
+#define FRAME_HIST_BUCKET_US 100 // Histogram resolution
+#define FRAME_HIST_BUCKETS 1000 // Covers 0-100 ms, slower frames all land in the last bucket
+
+typedef enum VsyncMode {
+	VS_OFF, // Paced by wait()
+	VS_ON,
+	VS_ADAPTIVE,
+} VsyncMode;
+
+class FramePacer {
+public:
+	FramePacer(double fps);
+
+	void setFps(double fps);
+	void setVsync(VsyncMode mode){ _vsync = mode; }
+	bool isVsync() const { return _vsync != VS_OFF; }
+
+	// Wait until the next frame is due. Call right before presenting. Does nothing with vsync on.
+	void wait();
+	// Call right after presenting, records the time since the previous frame
+	void frameDone();
+
+	uint64_t frames() const { return _frames; }
+	double percentileMs(double p) const; // p from 0 to 1, to histogram resolution
+	double maxMs() const { return _max_us/1000.0; }
+	void printReport() const; // One line summary on stdout
+	bool writeHistogram(const std::string& path) const; // CSV of bucket (ms) and frame count
+
+private:
+	Uint64 _freq, _period; // Performance counter ticks per second and per frame
+	Uint64 _next; // When the next frame is due
+	Uint64 _last_frame; // When the last frame was presented, 0 before the first
+	double _spin_us; // How long before a frame is due to stop sleeping and start spinning
+	VsyncMode _vsync;
+
+	std::array<uint32_t, FRAME_HIST_BUCKETS> _hist;
+	uint64_t _frames;
+	double _max_us;
+};
+
+#endif // FRAMEPACER_H
@@ -0,0 +1,34 @@
+#include "geometry.h"
+
+static const char* BOARD_SIZE_NAMES[NUM_BOARD_SIZES] = { "small", "medium", "large" };
+
+bool parseBoardSize(const std::string& name, BoardSize& size){
+	for (int i = 0; i < NUM_BOARD_SIZES; i++){
+		BoardSize s = (BoardSize)i;
+		if (name == BOARD_SIZE_NAMES[i] || name == std::to_string(boardCols(s)) + "x" + std::to_string(boardRows(s))){
+			size = s;
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* boardSizeName(BoardSize size){ return BOARD_SIZE_NAMES[size]; }
+
+int boardCols(BoardSize size){
+	switch (size){
+		case BS_SMALL: return SmallBoard::COLS;
+		case BS_MEDIUM: return MediumBoard::COLS;
+		case BS_LARGE: return LargeBoard::COLS;
+	}
+	return MediumBoard::COLS;
+}
+
+int boardRows(BoardSize size){
+	switch (size){
+		case BS_SMALL: return SmallBoard::ROWS;
+		case BS_MEDIUM: return MediumBoard::ROWS;
+		case BS_LARGE: return LargeBoard::ROWS;
+	}
+	return MediumBoard::ROWS;
+}
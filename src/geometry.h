@@ -0,0 +1,89 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+// Board dimensions as a type, so the game tick can be compiled for one board size: cell counts and
+// strides are constants, packing/unpacking cells on a power-of-two wide board is a shift and a mask
+// instead of a multiply and a divide, and a bounds check is one unsigned compare per axis.
+// BoardGeometry<0, 0> (AnyBoard) has the same interface but reads the size at runtime, for boards
+// that aren't one of the presets below.
+
+#include <string>
+
+#include "core.h"
+
+constexpr int log2i(int n){ return (n <= 1) ? 0 : 1 + log2i(n/2); }
+
+template<int W, int H>
+struct BoardGeometry {
+	static_assert(W > 0 && H > 0 && W*H <= 65536, "Board must fit in a 16 bit CellIndex");
+
+	static constexpr int COLS = W, ROWS = H, CELLS = W*H;
+	static constexpr bool POW2 = (W & (W-1)) == 0; // Width is a power of two
+	static constexpr int SHIFT = log2i(W); // Only meaningful if POW2
+
+	// Takes the size so generic code can build either kind of geometry the same way
+	constexpr BoardGeometry(int cols=W, int rows=H){}
+
+	static constexpr int cols(){ return W; }
+	static constexpr int rows(){ return H; }
+	static constexpr int cells(){ return CELLS; }
+	static constexpr bool inBounds(int x, int y){ return (unsigned)x < (unsigned)W && (unsigned)y < (unsigned)H; }
+	static constexpr int index(int x, int y){ return POW2 ? (y << SHIFT) | x : y*W + x; }
+	static constexpr int x(int i){ return POW2 ? i & (W-1) : i % W; }
+	static constexpr int y(int i){ return POW2 ? i >> SHIFT : i / W; }
+};
+
+template<>
+struct BoardGeometry<0, 0> {
+	BoardGeometry(int cols, int rows): _cols(cols), _rows(rows){}
+
+	int cols() const { return _cols; }
+	int rows() const { return _rows; }
+	int cells() const { return _cols*_rows; }
+	bool inBounds(int x, int y) const { return (unsigned)x < (unsigned)_cols && (unsigned)y < (unsigned)_rows; }
+	int index(int x, int y) const { return y*_cols + x; }
+	int x(int i) const { return i % _cols; }
+	int y(int i) const { return i / _cols; }
+
+private:
+	int _cols, _rows;
+};
+
+// Board sizes the game and tools can be started with (--board=small|medium|large).
+// All three are power-of-two wide.
+typedef enum BoardSize {
+	BS_SMALL,
+	BS_MEDIUM,
+	BS_LARGE,
+} BoardSize;
+
+#define NUM_BOARD_SIZES 3
+
+typedef BoardGeometry<32, 18> SmallBoard; // 40 px cells on screen
+typedef BoardGeometry<BOARD_COLS, BOARD_ROWS> MediumBoard; // The original 64x36 board, 20 px cells
+typedef BoardGeometry<128, 72> LargeBoard; // 10 px cells
+typedef BoardGeometry<0, 0> AnyBoard;
+
+// Every preset board has to fit in a GameSnapshot, the autopilot plans through them
+static_assert(SNAPSHOT_MAX_CELLS >= LargeBoard::CELLS && LargeBoard::CELLS >= MediumBoard::CELLS
+	&& LargeBoard::CELLS >= SmallBoard::CELLS, "SNAPSHOT_MAX_CELLS is too small for the preset boards");
+
+bool parseBoardSize(const std::string& name, BoardSize& size); // Returns false if name isn't a board size
+const char* boardSizeName(BoardSize size);
+int boardCols(BoardSize size);
+int boardRows(BoardSize size);
+
+// Calls fn with the preset geometry for a cols x rows board, or an AnyBoard if there isn't one,
+// so fn (usually a generic lambda) gets compiled once per preset
+template<class Fn>
+auto withBoardGeometry(int cols, int rows, Fn&& fn) -> decltype(fn(AnyBoard(cols, rows))){
+	if (cols == SmallBoard::COLS && rows == SmallBoard::ROWS)
+		return fn(SmallBoard());
+	if (cols == MediumBoard::COLS && rows == MediumBoard::ROWS)
+		return fn(MediumBoard());
+	if (cols == LargeBoard::COLS && rows == LargeBoard::ROWS)
+		return fn(LargeBoard());
+	return fn(AnyBoard(cols, rows));
+}
+
+#endif // GEOMETRY_H
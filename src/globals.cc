@@ -1,4 +1,5 @@
 #include "globals.h"
+#include "assets.h"
 
 std::unique_ptr<GameMaster> g_gamemaster = nullptr; // Global game master
 std::unique_ptr<SoundMaster> g_soundmaster = nullptr; // Global sound master
@@ -36,19 +37,49 @@ bool checkCollision(SDL_Rect a, SDL_Rect b){
 }
 
 bool initFonts(){
-	TTF_Init(); // Must always be called before using SDL_ttf API
-	
-	g_gamemaster->fonts = std::vector<TTF_Font*>(NUM_FONTS, nullptr);
+	return loadAssets(AS_FONTS); // The font file is read once, and the sizes are built in parallel
+}
 
-	g_gamemaster->fonts[0] = TTF_OpenFont(FONT_PATH, FONT_SIZE_SMALL);
-	g_gamemaster->fonts[1] = TTF_OpenFont(FONT_PATH, FONT_SIZE_MED);
-	g_gamemaster->fonts[2] = TTF_OpenFont(FONT_PATH, FONT_SIZE_LARGE);
+bool buildGlyphAtlas(TTF_Font* font, GlyphAtlas& atlas){
+	TRACE_ZONE("build glyph atlas");
+	// Rasterize each glyph on its own first to find out how big the atlas has to be
+	SDL_Color white = hexToColor(WHITE);
+	std::array<SDL_Surface*, NUM_GLYPHS> glyphs;
+	int w = 0;
+	atlas.height = TTF_FontHeight(font);
+	for (int i = 0; i < NUM_GLYPHS; i++){
+		int minx, maxx, miny, maxy, advance;
+		glyphs[i] = nullptr;
+		atlas.advance[i] = 0;
+		if (TTF_GlyphMetrics(font, GLYPH_FIRST+i, &minx, &maxx, &miny, &maxy, &advance) == 0){
+			atlas.advance[i] = advance;
+			glyphs[i] = TTF_RenderGlyph_Solid(font, GLYPH_FIRST+i, white);
+		}
+		atlas.rects[i] = {.x=w, .y=0, .w=glyphs[i] ? glyphs[i]->w : 0, .h=glyphs[i] ? glyphs[i]->h : 0};
+		w += atlas.rects[i].w;
+		atlas.height = std::max(atlas.height, atlas.rects[i].h);
+	}
 
-	if (!g_gamemaster->fonts[0] || !g_gamemaster->fonts[1] || !g_gamemaster->fonts[2]){
-		std::cerr << "Fatal Error: Font file \"" << FONT_PATH << "\" could not be found.\n";
-		return false;
+	// Fresh surfaces are all zeroes, so whatever isn't a glyph is transparent
+	atlas.surface = SDL_CreateRGBSurfaceWithFormat(0, std::max(w, 1), atlas.height, 32, SDL_PIXELFORMAT_ARGB8888);
+	for (int i = 0; i < NUM_GLYPHS; i++){
+		if (!glyphs[i])
+			continue;
+		if (atlas.surface)
+			SDL_BlitSurface(glyphs[i], NULL, atlas.surface, &atlas.rects[i]);
+		SDL_FreeSurface(glyphs[i]);
 	}
-	return true;
+	return atlas.surface != nullptr;
+}
+
+void freeFonts(){
+	for (GlyphAtlas& atlas : g_gamemaster->atlases)
+		SDL_FreeSurface(atlas.surface);
+	g_gamemaster->atlases.clear();
+	for (TTF_Font* font : g_gamemaster->fonts)
+		TTF_CloseFont(font);
+	g_gamemaster->fonts.clear();
+	freeAssetFiles();
 }
 // Return true if string is valid integer
 bool stringIsInt(std::string s){ return s.find_first_not_of("0123456789") == std::string::npos; }
@@ -10,32 +10,29 @@
 #include <SDL2/SDL_image.h> // For blitting images
 
 #include <iostream> // For printing
+#include <cmath>
 
 #include <memory> // For smart pointers
 				  
 // Collections
 #include <utility> // For std::pair
 #include <array>
-#include <deque> // For snake body
+#include <stdexcept> // For std::out_of_range
 #include <vector>
 // #include <vector>
 #include <chrono> // timing
 #include <thread>
 
+#include "core.h"
 #include "sounds.h"
 #include "save.h"
 
 #define GAME_VERSION "v0.0.4"
 
-// To ensure grid contains only full squares, GRID_CELL_SIZE must divide evenly into 
-// both SCREEN_W and SCREEN_H
-#define SCREEN_W 1280
-#define SCREEN_H 720
-#define GRID_CELL_SIZE 20
-
 #define FPS 60
 
 #define CD_LENGTH 3 // # of seconds that will elapse before game starts/resumes
+#define GAMEOVER_LENGTH 2 // # of seconds the game over screen stays up before going back to the main menu
 
 // Colors 
 #define BLACK 0x000000
@@ -62,25 +59,41 @@ typedef enum FontType {
 	F_LARGE,
 } FontType;
 
-SDL_Color hexToColor(unsigned long hex_color);
+// Glyph atlases cover printable ASCII, text with anything else is rasterized with TTF as a whole
+#define GLYPH_FIRST 32
+#define GLYPH_LAST 126
+#define NUM_GLYPHS (GLYPH_LAST-GLYPH_FIRST+1)
+
+// Every glyph of a font rendered once, white on transparent, side by side on one surface.
+// Strings are composed by blitting from here instead of rasterizing them (see TextCache).
+struct GlyphAtlas {
+	SDL_Surface* surface;
+	std::array<SDL_Rect, NUM_GLYPHS> rects; // Each glyph's part of surface (w is 0 if the font doesn't have it)
+	std::array<int, NUM_GLYPHS> advance; // How far the pen moves after each glyph
+	int height;
+};
 
-typedef enum MoveDir {
-	M_LEFT,
-	M_DOWN, 
-	M_RIGHT, 
-	M_UP,
-} MoveDir;
+SDL_Color hexToColor(unsigned long hex_color);
 
 typedef enum GameState {
 	GS_MAINMENU, // Main menu should render difficulty selection
 	GS_INGAME, 
 } GameState;
 
+// What the game is doing while in GS_INGAME. The timed phases are advanced by the main loop
+// rather than sleeping, so events keep being handled and frames keep being drawn.
+typedef enum IngamePhase {
+	IP_PLAYING,
+	IP_COUNTDOWN, // "Get ready..." then CD_LENGTH down to 1, a second each, before the game starts/resumes
+	IP_GAMEOVER, // The board frozen with the game over marker, for GAMEOVER_LENGTH seconds
+} IngamePhase;
+
 // Pause menu action enums
 typedef enum PauseAction {
 	PA_RESUME = -2,
 	PA_MAINMENU = -1,
 	PA_QUIT = 0,
+	PA_AUTOPILOT = -3, // Main menu toggle, shares the option space with the pause actions
 } PauseAction;
 
 // Encapsulate important game data into GameMaster
@@ -88,27 +101,41 @@ struct GameMaster {
 	GameState gstate;
 	std::string buff_str; // string buffer for displaying high score in main menu
 	int level;
-	int option; // Determines the length of each frame. Lower option value == higher difficulty,
+	int option; // Menu option of the button that started the game. Lower option value == higher difficulty,
 				// negative numbers are reserved for menu options.
 	bool reset; // If true, game should resett all objects (snake & food) and global variables
 	bool is_running; // Program should immediately exit if this variable is false
 	bool game_over; // Player lost, game should return to main menu
 	bool is_paused; // Game is currently running, but paused
+	bool autopilot; // The computer plays instead of the player (see autopilot.h)
+	bool turbo; // Run the game as fast as it will go instead of at the level's tick rate (see simclock.h)
 
-	bool cd_started; // Indicate the cooldown is starting
-	int cd_counter; // Keeps track of how many seconds remain before gameplay resumes/starts
+	IngamePhase phase;
+	Uint32 phase_start; // SDL_GetTicks() when the current phase started
 	std::vector<TTF_Font*> fonts;
+	std::vector<GlyphAtlas> atlases; // One per font, built by initFonts
+
+	void resetGame(){ gstate = GS_MAINMENU; reset = game_over, is_paused = false; phase = IP_PLAYING; }
 
-	void resetGame(){ gstate = GS_MAINMENU; reset = game_over, is_paused = false; }
+	void setPhase(IngamePhase p){
+		phase = p;
+		phase_start = SDL_GetTicks();
+	}
+	Uint32 phaseMs() const { return SDL_GetTicks() - phase_start; } // Time spent in the current phase
 
 	void startCD(){ // Should call this function when game starts or resumes from pause
 		is_paused = false;
-		cd_counter = CD_LENGTH;
-		cd_started = true;
+		setPhase(IP_COUNTDOWN);
+	}
+	// Number the countdown is showing, CD_LENGTH+1 during "Get ready..." and 0 once it's over
+	int cdCounter() const {
+		if (phase != IP_COUNTDOWN)
+			return 0;
+		return std::max(CD_LENGTH+1 - (int)(phaseMs()/1000), 0);
 	}
 
 	GameMaster(): gstate(GS_MAINMENU), buff_str(""), level(0), reset(false), is_running(true), game_over(false), 
-	is_paused(false), cd_started(false), cd_counter(0){}
+	is_paused(false), autopilot(false), turbo(false), phase(IP_PLAYING), phase_start(0){}
 };
 
 extern std::unique_ptr<GameMaster> g_gamemaster; // Global game master
@@ -116,9 +143,11 @@ extern std::unique_ptr<SoundMaster> g_soundmaster; // Global sound master
 
 void resetGame(GameMaster* gm); // Reset game master variables for new game
 
-// Call this before doing anything with fonts or else
+// Call this before doing anything with fonts or else (or loadAssets with AS_FONTS)
 // Returns false if anything fails during initialization
 bool initFonts();
+void freeFonts(); // Closes the fonts and frees their atlases
+bool buildGlyphAtlas(TTF_Font* font, GlyphAtlas& atlas); // Returns false if the atlas surface couldn't be made
 
 // Returns true if the two SDL_Rect objects overlap
 bool checkCollision(SDL_Rect a, SDL_Rect b); 
@@ -1,6 +1,11 @@
 #include "graphics.h"
+#include "simulation.h"
+#include "assets.h"
+
+#include <mutex>
 
 bool initIMG(){
+	TRACE_ZONE("initIMG");
 	if (IMG_Init(IMG_INIT_PNG) == 0){
 		std::cerr << "Error: SDL2_image failed to initialize!\n";
 		return false;
@@ -8,37 +13,99 @@ bool initIMG(){
 	return true;
 }
 
-bool GFX::loadImages(){
-	SDL_Surface* surface = nullptr;
-
-	surface = IMG_Load(IMG_PATH_AUDIO_ON);
-	_img_bank[IMG_AUDIO_ON] = SDL_CreateTextureFromSurface(_renderer, surface);
-	if (!_img_bank[IMG_AUDIO_ON]){
-		std::cerr << "Error: Texture for AUDIO_ON failed to load.\n";
-		return false;
-	}
-	SDL_FreeSurface(surface);
-	surface = nullptr;
-	
-	surface = IMG_Load(IMG_PATH_AUDIO_OFF);
-	_img_bank[IMG_AUDIO_OFF] = SDL_CreateTextureFromSurface(_renderer, surface);
-	if (!_img_bank[IMG_AUDIO_OFF]){
-		std::cerr << "Error: Texture for AUDIO_OFF failed to load.\n";
-		return false;
+bool GFX::loadImages(){ // Uploads the images loadAssets decoded
+	TRACE_ZONE("upload images");
+	static const char* IMG_NAMES[NUM_IMG] = { "AUDIO_ON", "AUDIO_OFF" };
+	for (int i = 0; i < NUM_IMG; i++){
+		Uint64 start = SDL_GetPerformanceCounter();
+		SDL_Surface* surface = takeImage((ImageType)i);
+		_img_bank[i] = surface ? SDL_CreateTextureFromSurface(_renderer, surface) : nullptr;
+		SDL_FreeSurface(surface);
+		if (!_img_bank[i]){
+			std::cerr << "Error: Texture for " << IMG_NAMES[i] << " failed to load.\n";
+			return false;
+		}
+		noteImageUpload((ImageType)i, (SDL_GetPerformanceCounter() - start)*1000.0/SDL_GetPerformanceFrequency());
 	}
-	SDL_FreeSurface(surface);
-	surface = nullptr;
-
 	return true;
 }
 
 void GFX::blitImage(ImageType image_type, int x, int y, int w, int h) const {
 	SDL_Rect dest = {.x=x,.y=y,.w=w,.h=h};
 	SDL_Texture* texture = _img_bank[image_type];
-	SDL_RenderCopy(_renderer, texture, NULL, &dest);
+	copyTexture(texture, NULL, &dest);
+}
+
+bool GFX::beginLayer(LayerType layer) const {
+	if (!_layer_support)
+		return true; // Drawn straight to the screen, every frame
+	if (!_layer_dirty[layer])
+		return false;
+	if (!_layers[layer]){
+		_layers[layer] = SDL_CreateTexture(_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, SCREEN_W, SCREEN_H);
+		if (!_layers[layer])
+			return true; // Out of video memory or similar, just draw to the screen
+		SDL_SetTextureBlendMode(_layers[layer], SDL_BLENDMODE_BLEND);
+	}
+	SDL_SetRenderTarget(_renderer, _layers[layer]);
+	SDL_SetRenderDrawColor(_renderer, 0, 0, 0, 0);
+	SDL_RenderClear(_renderer);
+	_layer_dirty[layer] = false;
+	TRACE_INSTANT("layer redraw");
+	return true;
+}
+
+void GFX::endLayer() const {
+	if (_layer_support)
+		SDL_SetRenderTarget(_renderer, NULL);
+}
+
+void GFX::drawLayer(LayerType layer) const {
+	if (_layer_support && _layers[layer])
+		copyTexture(_layers[layer], NULL, NULL);
+}
+
+// Target textures lose their contents when the renderer is reset (e.g. the window moves to another
+// GPU), so redraw every layer when that happens
+static int layerResetWatch(void* userdata, SDL_Event* e){
+	if (e->type == SDL_RENDER_TARGETS_RESET || e->type == SDL_RENDER_DEVICE_RESET)
+		((const GFX*)userdata)->markAllDirty();
+	return 0;
+}
+
+void GFX::fillRects(const SDL_Rect* rects, int n, SDL_Color color) const {
+	if (n == 0)
+		return;
+	SDL_SetRenderDrawColor(_renderer, color.r, color.g, color.b, color.a);
+	SDL_RenderFillRects(_renderer, rects, n);
+	_draw_calls++;
+}
+
+void GFX::copyTexture(SDL_Texture* texture, const SDL_Rect* src, const SDL_Rect* dst) const {
+	SDL_RenderCopy(_renderer, texture, src, dst);
+	_draw_calls++;
 }
 
 void GFX::init(){
+	TRACE_ZONE("GFX::init");
+	_img_bank.fill(nullptr);
+	_layers.fill(nullptr);
+
+	if (_target == GT_OFFSCREEN){
+		// No window and no images (the icons are only on the menus). Fonts have to be loaded already.
+		_surface = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_W, SCREEN_H, 32, SDL_PIXELFORMAT_RGBA32);
+		if (_surface)
+			_renderer = SDL_CreateSoftwareRenderer(_surface);
+		if (!_renderer){
+			fprintf(stderr, "Fatal Error: Offscreen renderer failed to initialize\n");
+			fprintf(stderr, "SDL2 Error: %s\n", SDL_GetError());
+			cleanQuit(false);
+		}
+		SDL_SetRenderDrawBlendMode(_renderer, SDL_BLENDMODE_BLEND);
+		_layer_support = SDL_RenderTargetSupported(_renderer);
+		markAllDirty();
+		return;
+	}
 
 	_window = SDL_CreateWindow("Snake++", 
 			SDL_WINDOWPOS_CENTERED, 
@@ -58,6 +125,7 @@ void GFX::init(){
 		fprintf(stderr, "SDL2 Error: %s\n", SDL_GetError());
 		cleanQuit(false);
 	}
+	_pacer.setVsync(VS_ON); // The browser paces frames
 	#else
 	_renderer = SDL_CreateRenderer(_window, -1, SDL_RENDERER_ACCELERATED);
 	_surface = SDL_GetWindowSurface(_window);
@@ -69,9 +137,7 @@ void GFX::init(){
 	}
 	#endif
 
-	if (!initIMG())
-		cleanQuit(false);
-
+	// SDL_image was set up by initIMG, and the images decoded by loadAssets, before the window
 	if (!loadImages())
 		cleanQuit(false);
 
@@ -81,27 +147,104 @@ void GFX::init(){
 	// SDL_RenderSetLogicalSize(_renderer, SCREEN_W, SCREEN_H);
 	// Allows for transparent rendering
 	SDL_SetRenderDrawBlendMode(_renderer, SDL_BLENDMODE_BLEND);
+
+	_layer_support = SDL_RenderTargetSupported(_renderer);
+	markAllDirty();
+	SDL_AddEventWatch(layerResetWatch, (void*)this);
 }
 
 
+bool GFX::setVsync(VsyncMode mode){
+	#ifdef EMSCRIPTEN
+	return mode != VS_OFF; // Always on in the browser
+	#else
+	if (mode == VS_ADAPTIVE){
+		if (SDL_RenderSetVSync(_renderer, -1) == 0){
+			_pacer.setVsync(VS_ADAPTIVE);
+			return true;
+		}
+		fprintf(stderr, "Adaptive vsync isn't supported (%s), trying plain vsync\n", SDL_GetError());
+		mode = VS_ON;
+	}
+	if (SDL_RenderSetVSync(_renderer, mode == VS_ON ? 1 : 0) != 0){
+		// Whatever the renderer is still doing, the pacer's own timing keeps frames from running flat out
+		fprintf(stderr, "Couldn't turn vsync %s: %s\n", mode == VS_ON ? "on" : "off", SDL_GetError());
+		_pacer.setVsync(VS_OFF);
+		return false;
+	}
+	_pacer.setVsync(mode);
+	return true;
+	#endif
+}
+
 void GFX::cleanQuit(bool success) const {
 	printf("Quitting, goodbye!\n");
+	if (_frame_report){
+		_pacer.printReport();
+		if (!_frame_csv.empty())
+			_pacer.writeHistogram(_frame_csv);
+	}
 	
+	destroy();
+
 	// Clean up fonts
-	for (TTF_Font* font : g_gamemaster->fonts)
-		TTF_CloseFont(font);
+	freeFonts();
 	TTF_Quit();
 	
 	// Clean up IMG
 	IMG_Quit();
 
 	// Clean up SDL
-	SDL_DestroyRenderer(_renderer);
-	SDL_DestroyWindow(_window);
 	SDL_Quit();
 	return (success) ? exit(EXIT_SUCCESS) : exit(EXIT_FAILURE);
 }
 
+void GFX::destroy() const {
+	TRACE_ZONE("GFX::destroy");
+	_text_cache.clear();
+	if (_window)
+		SDL_DelEventWatch(layerResetWatch, (void*)this);
+	for (SDL_Texture*& layer : _layers){
+		if (layer)
+			SDL_DestroyTexture(layer);
+		layer = nullptr;
+	}
+	for (SDL_Texture*& image : _img_bank){
+		if (image)
+			SDL_DestroyTexture(image);
+		image = nullptr;
+	}
+	if (_renderer)
+		SDL_DestroyRenderer(_renderer);
+	_renderer = nullptr;
+	if (_window)
+		SDL_DestroyWindow(_window); // Frees the window's surface too
+	else if (_surface)
+		SDL_FreeSurface(_surface);
+	_window = nullptr;
+	_surface = nullptr;
+}
+
+bool GFX::readPixels(std::vector<uint8_t>& rgba) const {
+	rgba.resize(SCREEN_W*SCREEN_H*4);
+	if (SDL_RenderReadPixels(_renderer, NULL, SDL_PIXELFORMAT_RGBA32, rgba.data(), SCREEN_W*4) != 0){
+		fprintf(stderr, "Couldn't read the frame back: %s\n", SDL_GetError());
+		return false;
+	}
+	return true;
+}
+
+bool GFX::savePNG(const std::string& path) const {
+	if (!readPixels(_pixels))
+		return false;
+	SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(_pixels.data(), SCREEN_W, SCREEN_H, 32, SCREEN_W*4, SDL_PIXELFORMAT_RGBA32);
+	bool saved = surface && IMG_SavePNG(surface, path.c_str()) == 0;
+	if (!saved)
+		std::cerr << "File Error: Couldn't write \"" << path << "\": " << SDL_GetError() << "\n";
+	SDL_FreeSurface(surface);
+	return saved;
+}
+
 void GFX::renderClear() const {
 	SDL_Color color = hexToColor(BLACK);
 	SDL_SetRenderDrawColor(_renderer, color.r, color.g, color.b, 255); // draw black screen
@@ -109,38 +252,57 @@ void GFX::renderClear() const {
 }
 
 void GFX::renderGrid() const {
-	SDL_Color color = hexToColor(GREY);
-	SDL_SetRenderDrawColor(_renderer, color.r, color.g, color.b, 255);
-	for (int y = 0; y < SCREEN_H; y += GRID_CELL_SIZE)
-		SDL_RenderDrawLine(_renderer, 0, y, SCREEN_W, y);
-	for (int x = 0; x < SCREEN_W; x += GRID_CELL_SIZE)
-		SDL_RenderDrawLine(_renderer, x, 0, x, SCREEN_H);
-}
-
-void GFX::renderFood(Food food) const {
-	SDL_Rect rect = food.getPos();
-	SDL_Color color = food.getColor();
-	SDL_SetRenderDrawColor(_renderer, color.r, color.g, color.b, 255);
-	SDL_RenderFillRect(_renderer, &rect);
-
-}
-
-void GFX::renderSnake(Snake snake) const {
-	SDL_Rect* head = snake.getHead();
-	SDL_Color color = snake.getColor();
-	SDL_SetRenderDrawColor(_renderer, color.r, color.g, color.b, 255);
-	SDL_RenderFillRect(_renderer, head);
-	for (size_t i = 0; i < snake.length()-1; i++){
-		SDL_Rect rect = snake.getBody().at(i);
-		SDL_RenderFillRect(_renderer, &rect);
+	// Lines are 1 pixel wide rects, so the whole grid is a single call, and only made once
+	if (beginLayer(L_GRID)){
+		_rect_batch.clear();
+		for (int y = 0; y < SCREEN_H; y += GRID_CELL_SIZE)
+			_rect_batch.push_back({.x=0, .y=y, .w=SCREEN_W, .h=1});
+		for (int x = 0; x < SCREEN_W; x += GRID_CELL_SIZE)
+			_rect_batch.push_back({.x=x, .y=0, .w=1, .h=SCREEN_H});
+		fillRects(_rect_batch.data(), _rect_batch.size(), hexToColor(GREY));
+		endLayer();
+	}
+	drawLayer(L_GRID);
+}
+
+void GFX::renderGame(const GameCore& game) const {
+	TRACE_ZONE("renderGame");
+	int dim = SCREEN_W/game.cols(); // Board fills the window whatever its size
+	Cell food = game.getFood();
+	SDL_Rect rect = {.x=food.x*dim, .y=food.y*dim, .w=dim, .h=dim};
+	fillRects(&rect, 1, hexToColor(GREEN));
+
+	Cell head = game.getHead();
+	_rect_batch.reserve(game.cols()*game.rows());
+	_rect_batch.clear();
+	_rect_batch.push_back({.x=head.x*dim, .y=head.y*dim, .w=dim, .h=dim});
+	const BodyRing& body = game.getBody();
+	for (size_t i = 0; i < body.size(); i++){
+		Cell c = game.toCell(body[i]);
+		_rect_batch.push_back({.x=c.x*dim, .y=c.y*dim, .w=dim, .h=dim});
 	}
+	fillRects(_rect_batch.data(), _rect_batch.size(), hexToColor(LIGHT_BLUE));
+}
+
+void GFX::renderSnapshot(const FrameSnapshot& snap) const {
+	TRACE_ZONE("renderSnapshot");
+	int dim = snap.dim;
+	SDL_Rect rect = {.x=snap.food.x*dim, .y=snap.food.y*dim, .w=dim, .h=dim};
+	fillRects(&rect, 1, hexToColor(GREEN));
+
+	_rect_batch.reserve(snap.body.size()+1);
+	_rect_batch.clear();
+	_rect_batch.push_back({.x=snap.head.x*dim, .y=snap.head.y*dim, .w=dim, .h=dim});
+	for (size_t i = 0; i < snap.body_len; i++){
+		CellIndex c = snap.body[i];
+		_rect_batch.push_back({.x=(c%snap.cols)*dim, .y=(c/snap.cols)*dim, .w=dim, .h=dim});
+	}
+	fillRects(_rect_batch.data(), _rect_batch.size(), hexToColor(LIGHT_BLUE));
 }
 
 // Renders a red square where the collision occurred and a game over message
 void GFX::renderGameover(SDL_Rect pos) const {
-	SDL_Color color = hexToColor(RED);
-	SDL_SetRenderDrawColor(_renderer, color.r, color.g, color.b, 255);
-	SDL_RenderFillRect(_renderer, &pos);
+	fillRects(&pos, 1, hexToColor(RED));
 
 	renderText("Game over!",
 		(SCREEN_W/3) + (GRID_CELL_SIZE*5), (GRID_CELL_SIZE*10),
@@ -149,61 +311,198 @@ void GFX::renderGameover(SDL_Rect pos) const {
 	// SDL_RenderPresent(_renderer);
 }
 
+void GFX::renderProfiler(const FrameProfiler& profiler) const {
+	int line_h = g_gamemaster->atlases[F_SMALL].height;
+	int x = GRID_CELL_SIZE/2, y = GRID_CELL_SIZE*2;
+	int graph_h = GRID_CELL_SIZE*4;
+	SDL_Rect box = {.x=x, .y=y, .w=PROF_GRAPH_FRAMES*2 + GRID_CELL_SIZE, .h=PROF_LINES*line_h + graph_h + GRID_CELL_SIZE};
+	SDL_Color shade = hexToColor(BLACK);
+	shade.a = 192;
+	fillRects(&box, 1, shade);
+
+	for (int i = 0; i < PROF_LINES; i++)
+		renderText(profiler.line(i), x + GRID_CELL_SIZE/2, y + GRID_CELL_SIZE/2 + i*line_h, WHITE, F_SMALL);
+
+	// Frame times, newest on the right, 2 px per frame. The height is 4x the frame budget; frames
+	// over budget are red, and the line is the budget.
+	double budget_ms = 1000.0/FPS;
+	int base = y + box.h - GRID_CELL_SIZE/2, left = x + GRID_CELL_SIZE/2;
+	size_t n = std::min(profiler.size(), (size_t)PROF_GRAPH_FRAMES);
+	for (int over = 0; over < 2; over++){
+		_rect_batch.clear();
+		for (size_t i = 0; i < n; i++){
+			const FrameSample& s = profiler.sample(profiler.size()-n+i);
+			if ((s.frame_ms > budget_ms+1) != (over == 1))
+				continue;
+			int h = std::min(graph_h, (int)(s.frame_ms/(budget_ms*4)*graph_h) + 1);
+			_rect_batch.push_back({.x=left + (int)(PROF_GRAPH_FRAMES-n+i)*2, .y=base-h, .w=2, .h=h});
+		}
+		fillRects(_rect_batch.data(), _rect_batch.size(), hexToColor(over ? RED : GREEN));
+	}
+	SDL_Rect budget = {.x=left, .y=base - graph_h/4, .w=PROF_GRAPH_FRAMES*2, .h=1};
+	fillRects(&budget, 1, hexToColor(WHITE));
+}
+
 // Also limits FPS
 void GFX::renderPresent() const { 
-	#ifdef EMSCRIPTEN
-	SDL_RenderPresent(_renderer);
-	#else
-	static double clock = 0;
-    double new_clock = SDL_GetTicks();
-    double delta = (1000.0/FPS)-(new_clock-clock);
-
-    if (floor(delta) > 0)
-        SDL_Delay(delta);
-
-    clock = (delta < -30) ?  new_clock-30 : new_clock+delta;
-	SDL_RenderPresent(_renderer);
-	#endif
+	TRACE_ZONE("renderPresent");
+	double text_ms = _text_cache.missMs();
+	if (_profiler){
+		_profiler->mark(PF_DRAW); // Everything since the last stage was drawing
+		_profiler->move(PF_DRAW, PF_TEXT, text_ms - _text_ms);
+	}
+	_text_ms = text_ms;
+
+	if (_target == GT_OFFSCREEN){ // Nobody's watching, so there's nothing to wait for
+		SDL_RenderPresent(_renderer);
+	} else {
+		_pacer.wait();
+		if (_profiler)
+			_profiler->mark(PF_WAIT);
+		SDL_RenderPresent(_renderer);
+		_pacer.frameDone();
+	}
+	if (_profiler)
+		_profiler->mark(PF_PRESENT);
+	_last_draw_calls = _draw_calls;
+	_draw_calls = 0;
 }
 
 // Renders the text in a line (Does not handle wrapping)
-void GFX::renderText(std::string text, int x, int y,
+void GFX::renderText(const char* text, int x, int y,
 		unsigned long hex_font_color, FontType font_type) const {
 
 	SDL_Color color = hexToColor(hex_font_color);
-	SDL_SetRenderDrawColor(_renderer, color.r, color.g, color.b, 255);
-	SDL_Surface* surface = TTF_RenderText_Solid(g_gamemaster->fonts[font_type], text.c_str(), color);
-	SDL_Texture* texture = SDL_CreateTextureFromSurface(_renderer, surface);
+	SDL_Rect rect = {.x=x, .y=y, .w=0, .h=0};
+	SDL_Texture* texture = _text_cache.get(_renderer, text, font_type, rect.w, rect.h);
+	if (!texture)
+		return;
+
+	SDL_SetTextureColorMod(texture, color.r, color.g, color.b);
+	copyTexture(texture, NULL, &rect);
+}
 
-	SDL_Rect rect = {.x=x, .y=y, .w=surface->w, .h=surface->h};
-	SDL_RenderCopy(_renderer, texture, NULL, &rect);
+SDL_Texture* TextCache::get(SDL_Renderer* renderer, const char* text, FontType font_type, int& w, int& h){
+	_key.assign(1, (char)font_type);
+	_key += text;
+	auto it = _index.find(_key);
+	if (it != _index.end()){
+		_hits++;
+		_lru.splice(_lru.begin(), _lru, it->second); // Move to the front, iterators stay valid
+		w = it->second->w;
+		h = it->second->h;
+		return it->second->texture;
+	}
 
+	TRACE_ZONE("text cache miss");
+	_misses++;
+	Uint64 start = SDL_GetPerformanceCounter();
+	SDL_Surface* surface;
+	{
+		// The atlases and fonts are shared by every GFX, and neither blitting from a surface nor
+		// TTF is safe on two threads at once
+		static std::mutex compose_lock;
+		std::lock_guard<std::mutex> lock(compose_lock);
+		surface = compose(text, font_type);
+	}
+	if (!surface)
+		return nullptr;
+	SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+	w = surface->w;
+	h = surface->h;
 	SDL_FreeSurface(surface);
-	SDL_DestroyTexture(texture);
+	_miss_time += SDL_GetPerformanceCounter() - start;
+	if (!texture)
+		return nullptr;
+
+	if (_lru.size() >= _capacity){
+		SDL_DestroyTexture(_lru.back().texture);
+		_index.erase(_lru.back().key);
+		_lru.pop_back();
+	}
+	_lru.push_front({.key=_key, .texture=texture, .w=w, .h=h});
+	_index[_key] = _lru.begin();
+	return texture;
+}
+
+SDL_Surface* TextCache::compose(const char* text, FontType font_type) const {
+	const GlyphAtlas& atlas = g_gamemaster->atlases[font_type];
+	SDL_Color white = hexToColor(WHITE);
+	if (!*text)
+		return nullptr;
+
+	// Lay the glyphs out the same way TTF would: each one where the previous one's advance left the pen
+	int pen = 0, w = 0;
+	for (const char* p = text; *p; p++){
+		unsigned char c = *p;
+		if (c < GLYPH_FIRST || c > GLYPH_LAST) // Not in the atlas, let TTF deal with it
+			return TTF_RenderText_Solid(g_gamemaster->fonts[font_type], text, white);
+		w = std::max(w, pen + atlas.rects[c-GLYPH_FIRST].w);
+		pen += atlas.advance[c-GLYPH_FIRST];
+	}
+
+	SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, std::max(w, 1), atlas.height, 32, SDL_PIXELFORMAT_ARGB8888);
+	if (!surface)
+		return nullptr;
+	pen = 0;
+	for (const char* p = text; *p; p++){
+		unsigned char c = *p;
+		SDL_Rect src = atlas.rects[c-GLYPH_FIRST];
+		SDL_Rect dst = {.x=pen, .y=0, .w=src.w, .h=src.h};
+		if (src.w > 0)
+			SDL_BlitSurface(atlas.surface, &src, surface, &dst);
+		pen += atlas.advance[c-GLYPH_FIRST];
+	}
+	return surface;
+}
+
+void TextCache::clear(){
+	for (Entry& e : _lru)
+		SDL_DestroyTexture(e.texture);
+	_lru.clear();
+	_index.clear();
 }
 
 void GFX::renderMenu(Menu* menu) const {
-	std::vector<Button*> btns = menu->getButtons();
+	TRACE_ZONE("renderMenu");
+	const std::vector<Button*>& btns = menu->getButtons();
 	SDL_Rect* bg_rect = menu->getBgRect();
-	if (bg_rect){
-		SDL_Color bgc = hexToColor(menu->getBgColor());	
-		SDL_SetRenderDrawColor(_renderer, bgc.r, bgc.g, bgc.b, 255);
-		SDL_RenderFillRect(_renderer, bg_rect);
+	if (bg_rect)
+		fillRects(bg_rect, 1, hexToColor(menu->getBgColor()));
+
+	// Buttons don't overlap, so their backgrounds can go out one call per colour (usually
+	// one for the idle buttons and one for the hovered one), then all the labels on top
+	_colored_batch.clear();
+	for (Button* btn : btns)
+		_colored_batch.push_back({.hex_color=btn->getCurrColor(), .rect=btn->getRect()});
+	// Insertion sort by colour, a handful of buttons and unlike std::stable_sort it never allocates
+	for (size_t i = 1; i < _colored_batch.size(); i++)
+		for (size_t j = i; j > 0 && _colored_batch[j-1].hex_color > _colored_batch[j].hex_color; j--)
+			std::swap(_colored_batch[j-1], _colored_batch[j]);
+	for (size_t i = 0; i < _colored_batch.size();){
+		_rect_batch.clear();
+		unsigned long hex_color = _colored_batch[i].hex_color;
+		for (; i < _colored_batch.size() && _colored_batch[i].hex_color == hex_color; i++)
+			_rect_batch.push_back(_colored_batch[i].rect);
+		fillRects(_rect_batch.data(), _rect_batch.size(), hexToColor(hex_color));
 	}
 
 	for (Button* btn : btns)
-		renderButton(btn);
+		renderButtonText(btn);
 }
 
 void GFX::renderButton(Button* btn) const {
+	// Render button background
+	SDL_Rect rect = btn->getRect();
+	fillRects(&rect, 1, hexToColor(btn->getCurrColor()));
+	renderButtonText(btn);
+}
+
+void GFX::renderButtonText(Button* btn) const {
 	SDL_Rect rect = btn->getRect();
-	std::string text = btn->getText();
+	const std::string& text = btn->getText();
 	FontType font_type = btn->getFontType();
-	SDL_Color btnc = hexToColor(btn->getCurrColor());
-	// Render button background
-	SDL_SetRenderDrawColor(_renderer, btnc.r, btnc.g, btnc.b, 255);
-	SDL_RenderFillRect(_renderer, &rect);
-	
+
 	// Be sure to compile with C++17 extensions via -Wc++17-extensions
 	// If C++17 is unavailable, then just change this to std::pair<float,flaot> 
 	// and unpack x_offset and y_offset manually
@@ -214,6 +513,12 @@ void GFX::renderButton(Button* btn) const {
 }
 
 void Button::handleEvents(SDL_Event* e){
+	unsigned long old_color = _hex_currcolor;
+	handleMouse(e);
+	_changed |= _hex_currcolor != old_color;
+}
+
+void Button::handleMouse(SDL_Event* e){
 	SDL_Rect rect = {
 		.x = _rect.x, .y = _rect.y,
 		.w = _rect.w, .h = _rect.h,
@@ -238,13 +543,13 @@ void Button::handleEvents(SDL_Event* e){
 
 	if (inside){
 		int level = 0;
-		std::string txt = getText();
+		const std::string& txt = getText();
 
 		if (_mouse_left_hitbox){ // Ensure sound only plays once until the mouse leaves the hitbox
 			_mouse_left_hitbox = false;
 			#ifndef EMSCRIPTEN
-			if (g_soundmaster && !g_soundmaster->isMuted() && g_soundmaster->getSound(S_MENUHOVER))
-				Mix_PlayChannel(-1, g_soundmaster->getSound(S_MENUHOVER), 0);
+			if (g_soundmaster)
+				g_soundmaster->play(S_MENUHOVER);
 			#endif
 			if (stringIsInt(txt)){
 				level = std::stoi(getText());
@@ -262,8 +567,8 @@ void Button::handleEvents(SDL_Event* e){
 
 		if (e->type == SDL_MOUSEBUTTONDOWN){
 			#ifndef EMSCRIPTEN
-			if (g_soundmaster && !g_soundmaster->isMuted() && g_soundmaster->getSound(S_MENUSELECT))
-				Mix_PlayChannel(-1, g_soundmaster->getSound(S_MENUSELECT), 0);
+			if (g_soundmaster)
+				g_soundmaster->play(S_MENUSELECT);
 			#endif
 			// negative numbers are reserved for pause menu actions
 			if (opt < 0){	
@@ -280,6 +585,11 @@ void Button::handleEvents(SDL_Event* e){
 					case PA_QUIT:
 						g_gamemaster->is_running = false;
 						break;
+					case PA_AUTOPILOT:
+						g_gamemaster->autopilot = !g_gamemaster->autopilot;
+						setText(g_gamemaster->autopilot ? "Autopilot: ON" : "Autopilot: OFF");
+						std::cout << "Autopilot " << (g_gamemaster->autopilot ? "on" : "off") << "\n";
+						break;
 				}
 			// level 0 is reserved for quit event,
 			} else if (opt == 0){
@@ -307,6 +617,13 @@ void Menu::handleEvents(SDL_Event* e){
 		btn->handleEvents(e);
 }
 
+bool Menu::takeChanged(){
+	bool changed = false;
+	for (Button* btn : _buttons)
+		changed |= btn->takeChanged(); // Every button's flag gets cleared
+	return changed;
+}
+
 Menu::Menu(std::vector<std::string> text, std::vector<int> levels,
 		 int x, int y, int w, int h,
 		 int ncols,
@@ -366,6 +683,9 @@ void Menu::setBackground(unsigned long hex_bgcolor, int border_sz){
 std::vector<std::string> btn_txt = { "1", "2", "3", "4", "5", "6", "7", "8", "9", "10" };
 // Lower level value indicates a harder difficulty
 std::vector<int> levels = { 10, 9, 8, 7, 6, 5, 4, 3, 2, 1 };
+// Game ticks per second for each level. Same speeds the levels used to have when they were
+// frames per tick at 60 FPS, but any rate works (above the refresh rate, several ticks run per frame).
+std::vector<double> level_hz = { 6, 60/9.0, 7.5, 60/7.0, 10, 12, 15, 20, 30, 60 };
 Menu* initMainMenu(){
 	Menu* main_menu = new Menu(btn_txt, levels,
 		((float)SCREEN_W/3) + ((float)GRID_CELL_SIZE*4.5f), (GRID_CELL_SIZE*10), // x, y
@@ -391,6 +711,16 @@ Button* initMainMenuQuitBtn(){
 	); 
 }
 
+Button* initMainMenuAutopilotBtn(){
+	return new Button(((float)SCREEN_W/2) - ((float)GRID_CELL_SIZE*5.25f), SCREEN_H/2 + (GRID_CELL_SIZE*3), // x, y
+		(GRID_CELL_SIZE*10), (GRID_CELL_SIZE*1.5f), // w, h
+		WHITE, // bg_color
+		g_gamemaster->autopilot ? "Autopilot: ON" : "Autopilot: OFF", F_SMALL, BLACK, // text, font_size, font_color
+		0.1f, 0.1f, // x_offset, y_offset (text within button)
+		PA_AUTOPILOT
+	);
+}
+
 /* Pause Menu stuff */
 // Text displayed on pause menu buttons
 std::vector<std::string> pause_menu_txt = { "Resume", "Main Menu", "Quit" };
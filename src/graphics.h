@@ -1,7 +1,11 @@
 #ifndef GRAPHICS_H
 #define GRAPHICS_H
-#include "snake.h"
 #include "globals.h"
+#include "framepacer.h"
+#include "profiler.h"
+
+#include <list>
+#include <unordered_map>
 
 #define ICON_SIZE 35
 
@@ -11,9 +15,13 @@
 class GFX;
 class Button;
 class Menu;
+struct FrameSnapshot;
 
 #define NUM_IMG 2
 
+#define TEXT_CACHE_SIZE 64 // Strings kept as textures, the least recently drawn one goes first
+#define PROF_GRAPH_FRAMES 200 // Frames in the profiler overlay's frame time graph
+
 bool initIMG();
 
 typedef enum {
@@ -21,33 +29,147 @@ typedef enum {
 	IMG_AUDIO_OFF,
 } ImageType;
 
+// Screens (or parts of them) that hardly ever change, so they're drawn once into a texture and
+// only redrawn when marked dirty. Everything else is drawn over them every frame.
+typedef enum LayerType {
+	L_MAINMENU, // The whole main menu
+	L_PAUSE, // Pause menu and text, drawn over the paused game
+	L_GRID, // Grey gridlines (renderGrid)
+} LayerType;
+
+#define NUM_LAYERS 3
+
+// Where a GFX draws. Offscreen it renders in software into a surface, with no window, display or
+// GPU, so frames can be made on a headless machine and on several threads at once (one GFX each).
+typedef enum GfxTarget {
+	GT_WINDOW,
+	GT_OFFSCREEN,
+} GfxTarget;
+
+// Textures of strings that have been drawn recently, so text that stays on screen isn't rasterized
+// and uploaded again every frame. Strings are composed from the font's glyph atlas, in white: the
+// colour is set when drawing, so one texture serves every colour.
+class TextCache {
+public:
+	TextCache(size_t capacity=TEXT_CACHE_SIZE): _capacity(capacity), _hits(0), _misses(0), _miss_time(0){}
+	~TextCache(){ clear(); }
+	TextCache(const TextCache&) = delete;
+	TextCache& operator=(const TextCache&) = delete;
+
+	// The texture for text in font_type, made on a miss. Sets w and h to its size.
+	// Returns nullptr if there's nothing to draw or the texture couldn't be made.
+	SDL_Texture* get(SDL_Renderer* renderer, const char* text, FontType font_type, int& w, int& h);
+	void clear(); // Destroy every cached texture
+
+	uint64_t hits() const { return _hits; }
+	uint64_t misses() const { return _misses; } // Each miss is one texture upload
+	double missMs() const { return _miss_time*1000.0/SDL_GetPerformanceFrequency(); } // Total time spent on misses
+
+private:
+	struct Entry {
+		std::string key; // Font type, then the text
+		SDL_Texture* texture;
+		int w, h;
+	};
+
+	SDL_Surface* compose(const char* text, FontType font_type) const;
+
+	size_t _capacity;
+	std::list<Entry> _lru; // Most recently drawn first
+	std::unordered_map<std::string, std::list<Entry>::iterator> _index;
+	std::string _key; // Lookup key, kept around so hits don't allocate
+	uint64_t _hits, _misses;
+	Uint64 _miss_time; // Performance counter ticks
+};
+
 class GFX {
 public:
 
-	GFX(): _window(nullptr), _surface(nullptr), _renderer(nullptr)
+	GFX(GfxTarget target=GT_WINDOW): _target(target), _layer_support(false), _draw_calls(0), _last_draw_calls(0),
+		_pacer(FPS), _frame_report(false), _profiler(nullptr), _text_ms(0),
+		_window(nullptr), _surface(nullptr), _renderer(nullptr)
 	{ init(); }
+	~GFX(){ destroy(); }
+	GFX(const GFX&) = delete;
+	GFX& operator=(const GFX&) = delete;
 
 	void init();
 	void cleanQuit(bool flag=true) const;
+	void destroy() const; // Free the renderer and everything made with it, also done by cleanQuit
 	void renderClear() const;
 	void renderGrid() const;
-	void renderFood(Food food) const;
-	void renderSnake(Snake snake) const;
-	void renderPresent() const; // Always call at the end of a frame
+	void renderGame(const GameCore& game) const; // Snake and food of a headless game (e.g. a replay)
+	void renderSnapshot(const FrameSnapshot& snap) const; // Snake and food as the simulation last published them
+	void renderPresent() const; // Always call at the end of a frame, waits for the next one to be due (on screen)
 	void renderGameover(SDL_Rect pos) const; // Render red square where snake died
+	void renderProfiler(const FrameProfiler& profiler) const; // Stage timings and a frame time graph, top left
 	
-	void renderText(std::string text, int x, int y,
+	void renderText(const char* text, int x, int y,
 			unsigned long hex_font_color, FontType font_type) const;
+	void renderText(const std::string& text, int x, int y,
+			unsigned long hex_font_color, FontType font_type) const {
+		renderText(text.c_str(), x, y, hex_font_color, font_type);
+	}
 	
 	void renderMenu(Menu* menu) const; // Render menu consisting of multiple buttons
 	void renderButton(Button* button) const; // Render a single button
+	void renderButtonText(Button* button) const; // Just the label, for when the background has been drawn already
 	
-	bool loadImages();
+	bool loadImages(); // Needs loadAssets(AS_IMAGES) first
 	void blitImage(ImageType image_type, int x, int y, int w, int h) const;
+
+	// Layers: if beginLayer returns true the layer is dirty, draw its contents and call endLayer.
+	// Then drawLayer puts it on screen. A layer starts out transparent. Without render target
+	// support every layer is always dirty, and its contents go straight to the screen.
+	bool beginLayer(LayerType layer) const;
+	void endLayer() const;
+	void drawLayer(LayerType layer) const;
+	void markDirty(LayerType layer) const { _layer_dirty[layer] = true; }
+	void markAllDirty() const { _layer_dirty.fill(true); } // e.g. the renderer lost its target textures
+
+	int drawCalls() const { return _last_draw_calls; } // Draw calls sent to the renderer in the last presented frame
+
+	// Copy the frame drawn so far out as SCREEN_W*SCREEN_H RGBA pixels, row by row
+	bool readPixels(std::vector<uint8_t>& rgba) const;
+	bool savePNG(const std::string& path) const;
+
+	// Let the display's refresh pace frames instead of the frame pacer. VS_ADAPTIVE falls back to
+	// VS_ON if the driver can't do it. Returns false, leaving the frame pacer to it, if neither works.
+	bool setVsync(VsyncMode mode);
+	// Print frame time percentiles on quitting, and write the histogram to csv_path if it isn't empty
+	void reportFramesOnQuit(const std::string& csv_path){ _frame_report = true; _frame_csv = csv_path; }
+	const FramePacer& pacer() const { return _pacer; }
+	// renderPresent marks the drawing, text, waiting and presenting stages of each frame in profiler
+	void setProfiler(FrameProfiler* profiler){ _profiler = profiler; }
+	const TextCache& textCache() const { return _text_cache; }
 private:
-	std::array<SDL_Texture*, NUM_IMG> _img_bank;
+	// Every draw goes through these two, so draw calls can be counted
+	void fillRects(const SDL_Rect* rects, int n, SDL_Color color) const;
+	void copyTexture(SDL_Texture* texture, const SDL_Rect* src, const SDL_Rect* dst) const;
+
+	struct ColoredRect {
+		unsigned long hex_color;
+		SDL_Rect rect;
+	};
+
+	GfxTarget _target;
+	mutable std::array<SDL_Texture*, NUM_IMG> _img_bank; // Mutable so destroy() can clear it
+	mutable TextCache _text_cache;
+	bool _layer_support; // Renderer can draw into textures
+	mutable std::array<SDL_Texture*, NUM_LAYERS> _layers;
+	mutable std::array<bool, NUM_LAYERS> _layer_dirty;
+	// Batches, kept between frames so they don't need allocating again
+	mutable std::vector<SDL_Rect> _rect_batch;
+	mutable std::vector<ColoredRect> _colored_batch;
+	mutable std::vector<uint8_t> _pixels; // savePNG's copy of the frame
+	mutable int _draw_calls, _last_draw_calls;
+	mutable FramePacer _pacer;
+	bool _frame_report;
+	std::string _frame_csv;
+	FrameProfiler* _profiler;
+	mutable double _text_ms; // Text cache miss time up to the last frame
 	mutable SDL_Window* _window;
-	mutable SDL_Surface* _surface;
+	mutable SDL_Surface* _surface; // Offscreen, the surface that's drawn on (and owned)
 	mutable SDL_Renderer* _renderer;
 };
 
@@ -64,24 +186,36 @@ public:
 			  _font_type(font), 
 			  _hex_bgcolor(hex_bgcolor), _hex_fontcolor(hex_fontcolor), _hex_currcolor(hex_bgcolor), 
 			  _x_offset(x_offset), _y_offset(y_offset),
-			  _option(level), _mouse_left_hitbox(true){}
+			  _option(level), _mouse_left_hitbox(true), _changed(true){}
 	
 	~Button();
 
 	void handleEvents(SDL_Event* e); // Handle button events
 	
 	/* Getters */
-	SDL_Rect getRect(){ return _rect; } // Button's background rect
-	unsigned long getBgColor(){ return _hex_bgcolor; }
-	unsigned long getFontColor(){ return _hex_fontcolor; }
-	unsigned long getCurrColor(){ return _hex_currcolor; }
-	int getOption(){ return _option; }
+	SDL_Rect getRect() const { return _rect; } // Button's background rect
+	unsigned long getBgColor() const { return _hex_bgcolor; }
+	unsigned long getFontColor() const { return _hex_fontcolor; }
+	unsigned long getCurrColor() const { return _hex_currcolor; }
+	int getOption() const { return _option; }
 
-	std::pair<float, float> getOffset(){ return std::make_pair(_x_offset, _y_offset); }
-	FontType getFontType(){ return _font_type; }
-	std::string getText(){ return _text; }
+	std::pair<float, float> getOffset() const { return std::make_pair(_x_offset, _y_offset); }
+	FontType getFontType() const { return _font_type; }
+	const std::string& getText() const { return _text; }
+	void setText(std::string text){
+		_changed |= text != _text;
+		_text = text;
+	}
+	// True if the button looks different since the last call (hovered, relabelled, or new)
+	bool takeChanged(){
+		bool changed = _changed;
+		_changed = false;
+		return changed;
+	}
 	
 private:
+	void handleMouse(SDL_Event* e);
+
 	SDL_Rect _rect;
 	std::string _text;
 	FontType _font_type;
@@ -89,6 +223,7 @@ private:
 	float _x_offset, _y_offset;
 	int _option;
 	bool _mouse_left_hitbox; // Prevent mouse sounds from playing multiple times when hovering over button
+	bool _changed;
 };
 
 class Menu {
@@ -107,7 +242,8 @@ public:
 	void handleEvents(SDL_Event* e);
 	
 	unsigned long getBgColor(){ return _hex_bgcolor; }
-	std::vector<Button*> getButtons(){ return _buttons; }
+	const std::vector<Button*>& getButtons() const { return _buttons; }
+	bool takeChanged(); // True if any button looks different since the last call
 	SDL_Rect* getBgRect(){ return _bgrect; }
 		
 	void setBackground(unsigned long hex_bgcolor, int border_sz=15);
@@ -123,8 +259,11 @@ private:
 
 
 /* Main menu stuff */
+extern std::vector<int> levels; // Menu option for each level's button (index 0 is level 1)
+extern std::vector<double> level_hz; // Ticks per second for each level (index 0 is level 1)
 Menu* initMainMenu();
 Button* initMainMenuQuitBtn();
+Button* initMainMenuAutopilotBtn(); // Label follows g_gamemaster->autopilot
 
 /* Pause button stuff */
 Menu* initPauseMenu();
@@ -0,0 +1,74 @@
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+// Lock-free handoffs between exactly two threads, one writing and one reading. Neither side ever
+// blocks or allocates, so a slow renderer can't hold up the simulation or the other way round.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Latest-value handoff. The writer fills back() and publishes it; the reader picks up whichever
+// value was published last, skipping any it missed. Three slots so each side always has one to
+// itself and the third holds the value in transit.
+template<class T>
+class TripleBuffer {
+public:
+	TripleBuffer(): _front(0), _back(1), _middle(2){}
+
+	// Writer side
+	T& back(){ return _slots[_back]; }
+	void publish(){ _back = _middle.exchange(_back | FRESH, std::memory_order_acq_rel) & INDEX; }
+
+	// Reader side. Returns true if a newer value was published since the last call.
+	bool update(){
+		if (!(_middle.load(std::memory_order_relaxed) & FRESH))
+			return false;
+		_front = _middle.exchange(_front, std::memory_order_acq_rel) & INDEX;
+		return true;
+	}
+	const T& front() const { return _slots[_front]; }
+
+private:
+	static const uint8_t INDEX = 3, FRESH = 4; // _middle holds a slot index, plus FRESH if it hasn't been read
+
+	T _slots[3];
+	uint8_t _front, _back; // Only touched by the reader and writer respectively
+	alignas(64) std::atomic<uint8_t> _middle;
+};
+
+// Bounded single producer, single consumer queue. N must be a power of two.
+template<class T, size_t N>
+class SpscQueue {
+	static_assert(N > 0 && (N & (N-1)) == 0, "SpscQueue size must be a power of two");
+public:
+	SpscQueue(): _head(0), _tail(0){}
+
+	// Producer side. Returns false if the queue is full.
+	bool push(const T& item){
+		size_t tail = _tail.load(std::memory_order_relaxed);
+		if (tail - _head.load(std::memory_order_acquire) == N)
+			return false;
+		_items[tail & (N-1)] = item;
+		_tail.store(tail+1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side. Returns false if the queue is empty.
+	bool pop(T& item){
+		size_t head = _head.load(std::memory_order_relaxed);
+		if (head == _tail.load(std::memory_order_acquire))
+			return false;
+		item = _items[head & (N-1)];
+		_head.store(head+1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	// On separate cache lines so the two threads don't fight over one
+	alignas(64) std::atomic<size_t> _head;
+	alignas(64) std::atomic<size_t> _tail;
+	T _items[N];
+};
+
+#endif // HANDOFF_H
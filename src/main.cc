@@ -1,36 +1,180 @@
 #include "globals.h"
 #include "graphics.h"
 #include "snake.h"
-#include <thread>
+#include "replay.h"
+#include "replayview.h"
+#include "autopilot.h"
+#include "geometry.h"
+#include "simclock.h"
+#include "simulation.h"
+#include "allocs.h"
+#include "profiler.h"
+#include "trace.h"
+#include "assets.h"
 #include <time.h>
+#include <cstring>
 
 void handleMainMenuInputs(GFX* gfx, SDL_Event event);
-void handleIngameInputs(GFX* gfx, Snake* snake, SDL_Event event);
+void handleIngameInputs(GFX* gfx, SDL_Event event);
 void handlePauseInputs(GFX* gfx, SDL_Event event);
 	
 Menu* main_menu = nullptr;
 Menu* pause_menu = nullptr;
 Button* quit_btn = nullptr;
+Button* autopilot_btn = nullptr;
+
+// The game itself (snake, food, autopilot, recording) runs in here, see simulation.h
+std::unique_ptr<Simulation> sim = nullptr;
+
+// F3 shows the profiler overlay, --profile=FILE starts with it on and writes what it recorded to FILE
+FrameProfiler profiler;
+std::string profile_csv;
+std::string trace_path; // --trace=FILE
+
+// --check-allocs: once a game is under way, a frame shouldn't allocate anything. The exception is
+// text that hasn't been drawn before (e.g. a new score), which the text cache makes a texture for.
+// Only the main thread's allocations are counted. If any frame allocated the game exits with an error.
+bool check_allocs = false;
+bool allocs_failed = false;
+uint64_t frame_allocs = 0, frame_text_misses = 0; // Counts when the current frame started
+uint64_t checked_frames = 0, alloc_frames = 0;
+
+void checkFrameAllocs(const GFX& gfx){
+	uint64_t allocs = allocCount() - frame_allocs;
+	checked_frames++;
+	if (allocs > 0 && gfx.textCache().misses() == frame_text_misses){
+		alloc_frames++;
+		allocs_failed = true;
+		fprintf(stderr, "Alloc check: gameplay frame %llu made %llu heap allocations\n",
+			(unsigned long long)checked_frames, (unsigned long long)allocs);
+	}
+}
+
+void printAllocCheck(){
+	if (!check_allocs || checked_frames == 0)
+		return;
+	printf("Alloc check: %llu of %llu gameplay frames allocated\n",
+		(unsigned long long)alloc_frames, (unsigned long long)checked_frames);
+	checked_frames = alloc_frames = 0;
+}
+
+// Stops the simulation thread before GFX::cleanQuit exits, so it isn't still running during exit()
+void quitGame(GFX* gfx){
+	if (sim)
+		sim->stop();
+	if (!profile_csv.empty())
+		profiler.writeCsv(profile_csv);
+	if (!trace_path.empty())
+		traceWrite(trace_path);
+	printAllocCheck();
+	gfx->cleanQuit(!allocs_failed);
+}
+
+void printAutopilotStats(const PlanStats& stats){
+	if (stats.plans == 0)
+		return;
+	printf("Autopilot planned %llu ticks: mean %.1f us, max %.1f us, %llu over budget\n",
+		(unsigned long long)stats.plans, stats.meanUs(), stats.max_us, (unsigned long long)stats.over_budget);
+}
+
+void printInputStats(const InputStats& stats){
+	if (stats.applied == 0 && stats.dropped == 0)
+		return;
+	printf("Input latency over %llu turns: mean %.1f ms, max %.0f ms, %llu dropped with the queue full\n",
+		(unsigned long long)stats.applied, stats.meanMs(), stats.max_ms, (unsigned long long)stats.dropped);
+}
 
 int main(int argc, char *argv[]){
+	Uint64 startup_start = SDL_GetPerformanceCounter();
 	
-	srand(time(NULL));
+	// Food placement is seeded from the clock unless a seed is given with --seed=N
+	uint64_t seed = time(NULL);
+	std::string replay_path;
+	std::string record_dir;
+	int plan_budget = AUTOPILOT_BUDGET_US;
+	BoardSize board = BS_MEDIUM;
+	double tick_hz = 0; // Overrides the level's tick rate if set
+	bool turbo = false;
+	bool log_input = false; // Print how long each turn waited for its tick
+	VsyncMode vsync = VS_OFF;
+	bool frame_stats = false; // Print frame time percentiles on exit
+	std::string frame_csv; // and write the histogram here
+	bool single_thread = false; // Run the simulation on the main thread, between frames
+	bool startup_report = false; // Print how long each asset took to load
+	for (int i = 1; i < argc; i++){
+		if (strncmp(argv[i], "--seed=", 7) == 0)
+			seed = strtoull(argv[i]+7, nullptr, 10);
+		else if (strncmp(argv[i], "--record=", 9) == 0)
+			record_dir = argv[i]+9;
+		else if (strncmp(argv[i], "--replay=", 9) == 0)
+			replay_path = argv[i]+9;
+		else if (strncmp(argv[i], "--autopilot-budget=", 19) == 0)
+			plan_budget = atoi(argv[i]+19);
+		else if (strncmp(argv[i], "--tick-hz=", 10) == 0)
+			tick_hz = atof(argv[i]+10);
+		else if (strcmp(argv[i], "--turbo") == 0)
+			turbo = true;
+		else if (strcmp(argv[i], "--log-input") == 0)
+			log_input = true;
+		else if (strcmp(argv[i], "--check-allocs") == 0)
+			check_allocs = true;
+		else if (strcmp(argv[i], "--single-thread") == 0)
+			single_thread = true;
+		else if (strcmp(argv[i], "--startup-report") == 0)
+			startup_report = true;
+		else if (strncmp(argv[i], "--trace=", 8) == 0)
+			trace_path = argv[i]+8;
+		else if (strncmp(argv[i], "--profile=", 10) == 0)
+			profile_csv = argv[i]+10;
+		else if (strcmp(argv[i], "--vsync") == 0)
+			vsync = VS_ON;
+		else if (strcmp(argv[i], "--vsync=adaptive") == 0)
+			vsync = VS_ADAPTIVE;
+		else if (strcmp(argv[i], "--frame-stats") == 0)
+			frame_stats = true;
+		else if (strncmp(argv[i], "--frame-stats=", 14) == 0){
+			frame_stats = true;
+			frame_csv = argv[i]+14;
+		}
+		else if (strncmp(argv[i], "--board=", 8) == 0 && !parseBoardSize(argv[i]+8, board)){
+			fprintf(stderr, "Fatal error: Unknown board size \"%s\" (try small, medium or large)\n", argv[i]+8);
+			exit(EXIT_FAILURE);
+		}
+	}
+	std::cout << "Seed: " << seed << "\n";
+	if (check_allocs && !allocCountingEnabled()){
+		fprintf(stderr, "Warning: --check-allocs needs a build configured with -DSNAKEPP_COUNT_ALLOCS=ON\n");
+		check_allocs = false;
+	}
+	if (!trace_path.empty() && !traceCompiledIn()){
+		fprintf(stderr, "Warning: --trace needs a build configured with -DSNAKEPP_TRACE=ON\n");
+		trace_path.clear();
+	}
+	if (!trace_path.empty()){ // Started early so loading shows up too
+		traceThreadName("main");
+		traceStart();
+	}
+	// The window stays the same size, bigger boards get smaller cells
+	int cols = boardCols(board), rows = boardRows(board);
 	
-	unsigned long long tick = 0;
-
 	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO)){ 
 		fprintf(stderr, "Fatal error: Failed to initialize SDL: %s\n", SDL_GetError());
 		exit(EXIT_FAILURE);
 	}
 
 	g_gamemaster = std::unique_ptr<GameMaster>(new GameMaster());
+	g_gamemaster->turbo = turbo;
 	if (!initIMG())
 		exit(EXIT_FAILURE);
-	if (!initFonts())
-		exit(EXIT_FAILURE);
+	int assets = AS_FONTS | AS_IMAGES;
 	#ifndef EMSCRIPTEN
-	initSounds(); // If sounds fail to load, game should still be playable so no need to exit here.
+	// If sounds fail to load, game should still be playable so no need to exit here.
+	if (initSounds())
+		assets |= AS_SOUNDS;
 	#endif
+	// Everything is decoded on worker threads here, GFX and SoundMaster just take it
+	if (!loadAssets(assets))
+		exit(EXIT_FAILURE);
 	
 	// Save data
 	if (!(g_savedata = saveLoad()))
@@ -44,27 +188,49 @@ int main(int argc, char *argv[]){
 	
 	// Graphics
 	std::unique_ptr<GFX> gfx = std::unique_ptr<GFX>(new GFX());
+	if (vsync != VS_OFF)
+		gfx->setVsync(vsync);
+	if (frame_stats)
+		gfx->reportFramesOnQuit(frame_csv);
+	gfx->setProfiler(&profiler);
+	profiler.setEnabled(!profile_csv.empty());
+	if (startup_report)
+		printStartupReport((SDL_GetPerformanceCounter() - startup_start)*1000.0/SDL_GetPerformanceFrequency());
+
+	if (!replay_path.empty()){
+		runReplay(gfx.get(), replay_path);
+		gfx->cleanQuit();
+	}
 	
 	// Game elements
-	std::unique_ptr<Snake> snake = std::unique_ptr<Snake>(
-			new Snake(
-				SCREEN_W/2, SCREEN_H/2, 
-				GRID_CELL_SIZE, LIGHT_BLUE
-			)
-	);
-	std::unique_ptr<Food> food = std::unique_ptr<Food>(
-			new Food(
-				SCREEN_W/2+GRID_CELL_SIZE, SCREEN_H/2+GRID_CELL_SIZE, 
-				GRID_CELL_SIZE, GREEN
-			)
-	);
-
-	SDL_Rect prev; // Store position of head in the previous iteration
+	sim = std::unique_ptr<Simulation>(new Simulation(cols, rows, seed, plan_budget, tick_hz, log_input, record_dir));
+	sim->send(SimCommand::turbo(turbo));
+	#ifdef EMSCRIPTEN
+	single_thread = true; // No threads in the web build
+	#endif
+	if (!single_thread)
+		sim->start();
+	uint32_t heard_eaten = 0; // Apples the eat sound has been played for this game
+	uint64_t profiled_seq = 0; // Last snapshot whose tick time went to the profiler
 	
 	while (g_gamemaster->is_running){
-		if (g_gamemaster->reset){
-			snake->reset();
-			food->setRandPos();
+		TRACE_ZONE("frame");
+		profiler.newFrame(gfx->drawCalls());
+		frame_allocs = allocCount();
+		frame_text_misses = gfx->textCache().misses();
+		if (single_thread){
+			sim->pump();
+			profiler.mark(PF_TICK);
+		}
+		if (g_gamemaster->reset){ // Player quit to the main menu mid-game
+			TRACE_INSTANT("quit to main menu");
+			const FrameSnapshot& snap = sim->latest();
+			printAllocCheck();
+			if (g_gamemaster->autopilot)
+				printAutopilotStats(snap.plan);
+			else
+				printInputStats(snap.input);
+			sim->send(SimCommand::newGame());
 			g_gamemaster->resetGame();
 			g_gamemaster->reset = false;
 		}
@@ -72,91 +238,121 @@ int main(int argc, char *argv[]){
 		switch(g_gamemaster->gstate){
 			case GS_MAINMENU:
 			{
+				TRACE_ZONE("main menu");
 				// Initialize the main_menu if it is NULL
 				if (!main_menu){
+					TRACE_ZONE("build main menu");
 					main_menu = initMainMenu();
 					quit_btn = initMainMenuQuitBtn();
+					autopilot_btn = initMainMenuAutopilotBtn();
 				}
 
 				gfx->renderClear();
 				SDL_Event event;
 
 				// Handle menu input
-				while (SDL_PollEvent(&event)){
-					handleMainMenuInputs(gfx.get(), event);
-					main_menu->handleEvents(&event);
-					quit_btn->handleEvents(&event);
+				{
+					TRACE_ZONE("events");
+					while (SDL_PollEvent(&event)){
+						handleMainMenuInputs(gfx.get(), event);
+						main_menu->handleEvents(&event);
+						quit_btn->handleEvents(&event);
+						autopilot_btn->handleEvents(&event);
+					}
 				}
-
-				gfx->renderText("Snake++", 
-					((float)SCREEN_W/3) + ((float)GRID_CELL_SIZE*4.5f), GRID_CELL_SIZE, 
-					WHITE, F_LARGE
-				);
-
-				gfx->renderMenu(main_menu);
-				// Render text above menu frame
-				gfx->renderText("Select Difficulty", 
-					((float)SCREEN_W/3) + ((float)GRID_CELL_SIZE*6.5f), (GRID_CELL_SIZE*8),
-					BLACK, F_SMALL
-				);
-				// Render quit button below main_menu
-				gfx->renderButton(quit_btn);
-
-				gfx->renderText("Made by: Hoswoo",
-					(GRID_CELL_SIZE), (SCREEN_H-(GRID_CELL_SIZE*2)),
-					WHITE, F_SMALL
-				);
-				// Display game version
-				gfx->renderText(GAME_VERSION,
-					(SCREEN_W - (GRID_CELL_SIZE*4)), (SCREEN_H-(GRID_CELL_SIZE*2)),
-					WHITE, F_SMALL
-				);
-				
-				// Render icon based on if sound is muted or unmuted
-				#ifndef EMSCRIPTEN
-				if (g_soundmaster && g_soundmaster->isMuted())
-					gfx->blitImage(IMG_AUDIO_OFF, 
-						SCREEN_W - (GRID_CELL_SIZE*2.5f), (GRID_CELL_SIZE/2),
-						ICON_SIZE, ICON_SIZE
+				profiler.mark(PF_EVENTS);
+
+				// The menu only looks different when a button is hovered or relabelled, or sound is muted,
+				// so it's kept in a layer and only redrawn then
+				if (main_menu->takeChanged() | quit_btn->takeChanged() | autopilot_btn->takeChanged())
+					gfx->markDirty(L_MAINMENU);
+				if (gfx->beginLayer(L_MAINMENU)){
+					gfx->renderClear();
+					gfx->renderText("Snake++", 
+						((float)SCREEN_W/3) + ((float)GRID_CELL_SIZE*4.5f), GRID_CELL_SIZE, 
+						WHITE, F_LARGE
 					);
-				else if (g_soundmaster)
-					gfx->blitImage(IMG_AUDIO_ON, 
-						SCREEN_W - (GRID_CELL_SIZE*2.5f), (GRID_CELL_SIZE/2),
-						ICON_SIZE, ICON_SIZE
+
+					gfx->renderMenu(main_menu);
+					// Render text above menu frame
+					gfx->renderText("Select Difficulty", 
+						((float)SCREEN_W/3) + ((float)GRID_CELL_SIZE*6.5f), (GRID_CELL_SIZE*8),
+						BLACK, F_SMALL
 					);
-				#endif
+					// Render quit button below main_menu
+					gfx->renderButton(quit_btn);
+					gfx->renderButton(autopilot_btn);
 
-				// Render high score
-				if (!g_gamemaster->buff_str.empty())
-					gfx->renderText(g_gamemaster->buff_str,
-						((float)SCREEN_W/3) + ((float)GRID_CELL_SIZE*4.8f), SCREEN_H/2,
+					gfx->renderText("Made by: Hoswoo",
+						(GRID_CELL_SIZE), (SCREEN_H-(GRID_CELL_SIZE*2)),
+						WHITE, F_SMALL
+					);
+					// Display game version
+					gfx->renderText(GAME_VERSION,
+						(SCREEN_W - (GRID_CELL_SIZE*4)), (SCREEN_H-(GRID_CELL_SIZE*2)),
 						WHITE, F_SMALL
 					);
+				
+					// Render icon based on if sound is muted or unmuted
+					#ifndef EMSCRIPTEN
+					if (g_soundmaster && g_soundmaster->isMuted())
+						gfx->blitImage(IMG_AUDIO_OFF, 
+							SCREEN_W - (GRID_CELL_SIZE*2.5f), (GRID_CELL_SIZE/2),
+							ICON_SIZE, ICON_SIZE
+						);
+					else if (g_soundmaster)
+						gfx->blitImage(IMG_AUDIO_ON, 
+							SCREEN_W - (GRID_CELL_SIZE*2.5f), (GRID_CELL_SIZE/2),
+							ICON_SIZE, ICON_SIZE
+						);
+					#endif
 
+					// Render high score
+					if (!g_gamemaster->buff_str.empty())
+						gfx->renderText(g_gamemaster->buff_str,
+							((float)SCREEN_W/3) + ((float)GRID_CELL_SIZE*4.8f), SCREEN_H/2,
+							WHITE, F_SMALL
+						);
+					gfx->endLayer();
+				}
+				gfx->drawLayer(L_MAINMENU);
+
+				if (profiler.enabled())
+					gfx->renderProfiler(profiler);
 				gfx->renderPresent();
 			}
 			break; // End GS_MAINMENU
 
 			case GS_INGAME:
 			{
+				TRACE_ZONE("in game");
 				gfx->renderClear();
 
 				// Free up main_menu memory if game is being played
 				if (main_menu){
+					TRACE_ZONE("free main menu");
 					delete main_menu;
 					delete quit_btn;
+					delete autopilot_btn;
 					main_menu = nullptr;
 					quit_btn = nullptr;
+					autopilot_btn = nullptr;
 				}
 
 				SDL_Event event;
-				SDL_Rect* coll = nullptr;
+				const FrameSnapshot& snap = sim->latest();
+				if (!single_thread && snap.seq != profiled_seq){ // Ticked on the simulation thread
+					profiler.add(PF_TICK, snap.tick_ms);
+					profiled_seq = snap.seq;
+				}
 
 				if (g_gamemaster->is_paused){ // Game is paused, handle the pause menu
+					TRACE_ZONE("events");
 					while (SDL_PollEvent(&event)){
 						pause_menu->handleEvents(&event);
 						handlePauseInputs(gfx.get(), event);
 					}
+					profiler.mark(PF_EVENTS);
 
 				} else { // Game is unpaused, handle gameplay
 					if (pause_menu){ // If pause menu is allocated to memory, free it and set it to NULL
@@ -164,174 +360,212 @@ int main(int argc, char *argv[]){
 						pause_menu = nullptr;
 					}
 					
-					while (SDL_PollEvent(&event))
-						handleIngameInputs(gfx.get(), snake.get(), event);
-
-					// All events in this if statement are considered the "game tick"
-					if (g_gamemaster->cd_counter < 0 && (tick % g_gamemaster->option == 0)){
-						// If the snake ate the food
-						if (checkCollision(*snake->getHead(), food->getPos())){
-							snake->handleEatEvents(food.get());
-							if (snake->length()-1 == 1) // English majors be like
+					{
+						TRACE_ZONE("events");
+						while (SDL_PollEvent(&event))
+							handleIngameInputs(gfx.get(), event);
+					}
+					profiler.mark(PF_EVENTS);
+
+					// Move on from the timed phases once their time is up. The countdown doesn't count
+					// towards the first tick, the simulation only starts when it's over.
+					if (g_gamemaster->phase == IP_COUNTDOWN && g_gamemaster->cdCounter() == 0){
+						TRACE_INSTANT("countdown over");
+						g_gamemaster->setPhase(IP_PLAYING);
+						sim->send(SimCommand::run(level_hz[g_gamemaster->level-1], g_gamemaster->level, g_gamemaster->autopilot));
+					}
+					if (g_gamemaster->phase == IP_GAMEOVER && g_gamemaster->phaseMs() >= GAMEOVER_LENGTH*1000){
+						TRACE_INSTANT("back to main menu");
+						sim->send(SimCommand::newGame());
+						g_gamemaster->gstate = GS_MAINMENU;
+						g_gamemaster->setPhase(IP_PLAYING);
+						continue;
+					}
+
+					// React to what the simulation did since the last frame
+					if (snap.eaten != heard_eaten){
+						if (snap.eaten > heard_eaten){ // Otherwise it's a new game
+							if (snap.length-1 == 1) // English majors be like
 								std::cout << "Snake has eaten 1 apple!\n";
 							else
-								std::cout << "Snake has eaten " << snake->length()-1 << " apples!\n";
+								std::cout << "Snake has eaten " << snap.length-1 << " apples!\n";
 							#ifndef EMSCRIPTEN
-							if (g_soundmaster && !g_soundmaster->isMuted() && g_soundmaster->getSound(S_EAT))
-								Mix_PlayChannel(-1, g_soundmaster->getSound(S_EAT), 0);
+							if (g_soundmaster)
+								g_soundmaster->play(S_EAT);
 							#endif
 						}
+						heard_eaten = snap.eaten;
+					}
 
-						snake->handleMovement();
-
-						// If the snake collided with itself, then it's game over
-						if ((coll = snake->checkSnakeCollision())){
-							g_gamemaster->game_over = true;
+					if (g_gamemaster->phase == IP_PLAYING && snap.state == SS_OVER){
+						TRACE_ZONE("game over");
+						if (snap.won)
+							std::cout << "The snake filled the whole board, you win!\n";
+						if (snap.self_hit)
 							std::cout << "Snake committed sudoku\n";
-						}
-
-						if (g_gamemaster->game_over){
-							#ifndef EMSCRIPTEN
-							if (g_soundmaster && !g_soundmaster->isMuted() && g_soundmaster->getSound(S_EXPLOSION))
-								Mix_PlayChannel(-1, g_soundmaster->getSound(S_EXPLOSION), 0);
-							#endif
-							
-							if (snake->length() == 2) // English majors be like
-								std::cout << "Game over! Your snake died after eating 1 apple.\n";
-							else
-								std::cout << "Game over! Your snake died after eating " << snake->length()-1 << " apples.\n";
-							
-							// If coll wasn't set, then the gameover location must be at the snake's head's previous location
-							if (!coll)
-								coll = &prev;
-
-							g_gamemaster->gstate = GS_MAINMENU;
-							g_gamemaster->game_over = g_gamemaster->is_paused = false;
-
-							gfx->renderFood(*food);
-							gfx->renderSnake(*snake);
-							gfx->renderGameover(prev);
-
-							// Render score
-							gfx->renderText(std::string("SCORE: " + std::to_string(snake->length()-1)),
-									(GRID_CELL_SIZE/2), (GRID_CELL_SIZE/2),
-									WHITE, F_SMALL
-							);
-
-							gfx->renderPresent();
-							// Update save file score
-							saveUpdate(g_gamemaster->level, snake->length()-1);
-							std::this_thread::sleep_for(std::chrono::seconds(2)); // Add some delay before game starts up again
-
-							snake->reset();
-							food->setRandPos();
-							continue;	
-						}
-					}
+						#ifndef EMSCRIPTEN
+						if (g_soundmaster)
+							g_soundmaster->play(S_EXPLOSION);
+						#endif
 					
-					// Update direction only if we're in a game tick
-					if (g_gamemaster->cd_counter < 0 && (tick % g_gamemaster->option == 0)){
-						snake->updateDir();
+						if (snap.length == 2) // English majors be like
+							std::cout << "Game over! Your snake died after eating 1 apple.\n";
+						else
+							std::cout << "Game over! Your snake died after eating " << snap.length-1 << " apples.\n";
+					
+						// Update save file score, autopilot games don't count
+						printAllocCheck();
+						if (g_gamemaster->autopilot){
+							printAutopilotStats(snap.plan);
+						} else {
+							saveUpdate(g_gamemaster->level, snap.length-1);
+							printInputStats(snap.input);
+						}
+						// Leave the board up for a bit before going back to the main menu
+						g_gamemaster->setPhase(IP_GAMEOVER);
 					}
 
 					// gfx->renderGrid(); // Render grey gridlines (might remove from final build)
-
-					prev = *snake->getHead();
-					tick++;
 				} // End else
 				  
-				gfx->renderFood(*food);
-				gfx->renderSnake(*snake);
+				gfx->renderSnapshot(snap);
+				// The gameover location is the snake's head's previous location
+				if (g_gamemaster->phase == IP_GAMEOVER)
+					gfx->renderGameover({.x=snap.death.x*snap.dim, .y=snap.death.y*snap.dim, .w=snap.dim, .h=snap.dim});
 
 				// Render score
-				gfx->renderText(std::string("SCORE: " + std::to_string(snake->length()-1)),
+				char hud[32]; // HUD text is formatted on the stack, so drawing it doesn't allocate
+				snprintf(hud, sizeof(hud), "SCORE: %zu", snap.length-1);
+				gfx->renderText(hud,
 						(GRID_CELL_SIZE/2), (GRID_CELL_SIZE/2),
 						WHITE, F_SMALL
 				);
 				
-				// These ifs are down here because we want them rendered on top of all the other game elements	
-				if (!g_gamemaster->cd_started && g_gamemaster->cd_counter > -1){
-					gfx->renderText(std::to_string(g_gamemaster->cd_counter).c_str(),
-						SCREEN_W/2, SCREEN_H/2,
-						WHITE, F_LARGE
-					);
-					std::this_thread::sleep_for(std::chrono::seconds(1));
-					g_gamemaster->cd_counter--;
-				}
-				
-				// This is for allowing the game to render the first frame before the cooldown starts
-				if (g_gamemaster->cd_started){
-					g_gamemaster->cd_started = false;
-					gfx->renderText("Get ready...",
-						(SCREEN_W/2)-(GRID_CELL_SIZE*6), ((SCREEN_H/2)-(GRID_CELL_SIZE*2)),
-						WHITE, F_LARGE
+				if (g_gamemaster->autopilot){
+					snprintf(hud, sizeof(hud), "AUTOPILOT %d us", (int)snap.plan.last_us);
+					gfx->renderText(hud,
+						(SCREEN_W - (GRID_CELL_SIZE*13)), (GRID_CELL_SIZE/2),
+						WHITE, F_SMALL
 					);
 				}
 
-				if (g_gamemaster->is_paused){
-					gfx->renderMenu(pause_menu);
-					gfx->renderText("Made by: Hoswoo",
-						(GRID_CELL_SIZE), (SCREEN_H-(GRID_CELL_SIZE*2)),
-						WHITE, F_SMALL
-					);
-					gfx->renderText("Paused",
-						(SCREEN_W/2), (GRID_CELL_SIZE*10),
-						WHITE, F_SMALL
-					);
-					// Display game version
-					gfx->renderText(GAME_VERSION,
-						(SCREEN_W - (GRID_CELL_SIZE*4)), (SCREEN_H-(GRID_CELL_SIZE*2)),
+				if (g_gamemaster->turbo)
+					gfx->renderText("TURBO",
+						(SCREEN_W/2) - (GRID_CELL_SIZE*2), (GRID_CELL_SIZE/2),
 						WHITE, F_SMALL
 					);
 
-					// Render icon based on if sound is muted or unmuted
-					#ifndef EMSCRIPTEN
-					if (g_soundmaster && g_soundmaster->isMuted())
-						gfx->blitImage(IMG_AUDIO_OFF, 
-							SCREEN_W - (GRID_CELL_SIZE*2.5f), (GRID_CELL_SIZE/2),
-							ICON_SIZE, ICON_SIZE
+				// These ifs are down here because we want them rendered on top of all the other game elements	
+				if (!g_gamemaster->is_paused && g_gamemaster->phase == IP_COUNTDOWN){
+					int count = g_gamemaster->cdCounter();
+					if (count > CD_LENGTH) // First second of the countdown
+						gfx->renderText("Get ready...",
+							(SCREEN_W/2)-(GRID_CELL_SIZE*6), ((SCREEN_H/2)-(GRID_CELL_SIZE*2)),
+							WHITE, F_LARGE
 						);
-					else if (g_soundmaster)
-						gfx->blitImage(IMG_AUDIO_ON, 
-							SCREEN_W - (GRID_CELL_SIZE*2.5f), (GRID_CELL_SIZE/2),
-							ICON_SIZE, ICON_SIZE
+					else if (count > 0){
+						snprintf(hud, sizeof(hud), "%d", count);
+						gfx->renderText(hud,
+							SCREEN_W/2, SCREEN_H/2,
+							WHITE, F_LARGE
 						);
-					#endif
+					}
+				}
+
+				if (g_gamemaster->is_paused){
+					// Only the game underneath is drawn every frame, the pause screen is a layer on top
+					if (pause_menu->takeChanged())
+						gfx->markDirty(L_PAUSE);
+					if (gfx->beginLayer(L_PAUSE)){
+						gfx->renderMenu(pause_menu);
+						gfx->renderText("Made by: Hoswoo",
+							(GRID_CELL_SIZE), (SCREEN_H-(GRID_CELL_SIZE*2)),
+							WHITE, F_SMALL
+						);
+						gfx->renderText("Paused",
+							(SCREEN_W/2), (GRID_CELL_SIZE*10),
+							WHITE, F_SMALL
+						);
+						// Display game version
+						gfx->renderText(GAME_VERSION,
+							(SCREEN_W - (GRID_CELL_SIZE*4)), (SCREEN_H-(GRID_CELL_SIZE*2)),
+							WHITE, F_SMALL
+						);
+
+						// Render icon based on if sound is muted or unmuted
+						#ifndef EMSCRIPTEN
+						if (g_soundmaster && g_soundmaster->isMuted())
+							gfx->blitImage(IMG_AUDIO_OFF, 
+								SCREEN_W - (GRID_CELL_SIZE*2.5f), (GRID_CELL_SIZE/2),
+								ICON_SIZE, ICON_SIZE
+							);
+						else if (g_soundmaster)
+							gfx->blitImage(IMG_AUDIO_ON, 
+								SCREEN_W - (GRID_CELL_SIZE*2.5f), (GRID_CELL_SIZE/2),
+								ICON_SIZE, ICON_SIZE
+							);
+						#endif
+						gfx->endLayer();
+					}
+					gfx->drawLayer(L_PAUSE);
 				} // End if(g_gamemaster->is_paused())
 
+				if (profiler.enabled())
+					gfx->renderProfiler(profiler);
 				gfx->renderPresent();
+				if (check_allocs && g_gamemaster->phase == IP_PLAYING && !g_gamemaster->is_paused)
+					checkFrameAllocs(*gfx);
 				break; 
 			} // End GS_INGAME
 		} // End switch(g_game_state)
 	} // End while(g_is_running)
 	
-	gfx->cleanQuit();
+	quitGame(gfx.get());
 }
 
-void handleIngameInputs(GFX* gfx, Snake* snake, SDL_Event event){
-	if (g_gamemaster->cd_counter > 0) // Don't handle any input events if the cooldown is still running
+void handleIngameInputs(GFX* gfx, SDL_Event event){
+	bool game_over = g_gamemaster->phase == IP_GAMEOVER;
+	if (game_over && event.type == SDL_QUIT){ // Nothing left to pause
+		g_gamemaster->is_running = false;
 		return;
+	}
 	// Open pause menu if player presses ESC or P, or tries to exit manually
-	if (event.type == SDL_QUIT || 
-			(event.type == SDL_KEYDOWN && (event.key.keysym.sym == SDLK_ESCAPE || event.key.keysym.sym == SDLK_p))){
+	if (!game_over && (event.type == SDL_QUIT || 
+			(event.type == SDL_KEYDOWN && (event.key.keysym.sym == SDLK_ESCAPE || event.key.keysym.sym == SDLK_p)))){
 		pause_menu = initPauseMenu();
 		g_gamemaster->is_paused = true;
+		TRACE_INSTANT("paused");
+		sim->send(SimCommand::hold());
 	}
+	// Steering opens up in the last second of the countdown, so the first move can be lined up
+	bool can_steer = !game_over && !g_gamemaster->autopilot && g_gamemaster->cdCounter() <= 1;
 
 	switch(event.type){
 		case SDL_KEYDOWN:
+			if (event.key.keysym.sym == SDLK_t){ // Toggle turbo (uncapped tick rate)
+				g_gamemaster->turbo = !g_gamemaster->turbo;
+				sim->send(SimCommand::turbo(g_gamemaster->turbo));
+				(g_gamemaster->turbo) ? std::cout << "Turbo on\n" : std::cout << "Turbo off\n";
+				break;
+			}
+			if (event.key.keysym.sym == SDLK_F3){ // Toggle the profiler overlay
+				profiler.setEnabled(!profiler.enabled());
+				break;
+			}
+			if (!can_steer && event.key.keysym.sym != SDLK_m)
+				break; // Hands off the wheel
 			switch(event.key.keysym.sym){
 				case SDLK_w: case SDLK_UP:
-					snake->setBuffDir(M_UP);
+					sim->send(SimCommand::turn(M_UP, event.key.timestamp));
 					break;
 				case SDLK_s: case SDLK_DOWN:
-					snake->setBuffDir(M_DOWN);
+					sim->send(SimCommand::turn(M_DOWN, event.key.timestamp));
 					break;
 				case SDLK_a: case SDLK_LEFT:
-					snake->setBuffDir(M_LEFT);
+					sim->send(SimCommand::turn(M_LEFT, event.key.timestamp));
 					break;
 				case SDLK_d: case SDLK_RIGHT:
-					snake->setBuffDir(M_RIGHT);
+					sim->send(SimCommand::turn(M_RIGHT, event.key.timestamp));
 					break;
 				#ifndef EMSCRIPTEN
 				case SDLK_m: // Mute/unmute sound
@@ -359,6 +593,7 @@ void handlePauseInputs(GFX* gfx, SDL_Event event){
 				case SDLK_m: // Mute/unmute sound
 					if (g_soundmaster){
 						g_soundmaster->toggleMuted();
+						gfx->markDirty(L_PAUSE); // Sound icon changed
 						(g_soundmaster->isMuted()) ? std::cout << "Sound muted\n" : std::cout << "Sound unmuted\n";
 					}
 					break;
@@ -375,11 +610,11 @@ void handleMainMenuInputs(GFX* gfx, SDL_Event event){
 	#ifndef EMSCRIPTEN
 	if (event.type == SDL_QUIT ||
 			(event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE))
-		gfx->cleanQuit();
+		quitGame(gfx);
 	#else
 	// In web builds, only handle window close, not ESC key
 	if (event.type == SDL_QUIT)
-		gfx->cleanQuit();
+		quitGame(gfx);
 	#endif
 
 	switch(event.type){ // Allow player to mute/unmute in main menu
@@ -389,6 +624,7 @@ void handleMainMenuInputs(GFX* gfx, SDL_Event event){
 				case SDLK_m: // Mute/unmute sound
 					if (g_soundmaster){
 						g_soundmaster->toggleMuted();
+						gfx->markDirty(L_MAINMENU); // Sound icon changed
 						(g_soundmaster->isMuted()) ? std::cout << "Sound muted\n" : std::cout << "Sound unmuted\n";
 					}
 					break;
@@ -0,0 +1,46 @@
+#include "policy.h"
+#include "autopilot.h"
+
+#include <cstdlib>
+
+static const MoveDir ALL_DIRS[] = { M_LEFT, M_DOWN, M_RIGHT, M_UP };
+
+MoveDir RandomPolicy::nextDir(const GameCore& game){
+	MoveDir safe[4];
+	int nsafe = 0;
+	for (MoveDir dir : ALL_DIRS)
+		if (!isReverse(dir, game.getDir()) && !game.blocked(moveCell(game.getHead(), dir)))
+			safe[nsafe++] = dir;
+	if (nsafe == 0)
+		return game.getDir(); // Nothing survives, might as well keep going
+	return safe[_rng.bounded(nsafe)];
+}
+
+MoveDir GreedyPolicy::nextDir(const GameCore& game){
+	Cell head = game.getHead(), food = game.getFood();
+	MoveDir best = game.getDir();
+	int best_dist = -1;
+	for (MoveDir dir : ALL_DIRS){
+		Cell next = moveCell(head, dir);
+		if (isReverse(dir, game.getDir()) || game.blocked(next))
+			continue;
+		int dist = abs(next.x-food.x) + abs(next.y-food.y);
+		if (best_dist < 0 || dist < best_dist){
+			best = dir;
+			best_dist = dist;
+		}
+	}
+	return best;
+}
+
+std::vector<std::string> policyNames(){ return { "random", "greedy", "autopilot" }; }
+
+std::unique_ptr<Policy> makePolicy(const std::string& name, uint64_t seed){
+	if (name == "random")
+		return std::unique_ptr<Policy>(new RandomPolicy(seed));
+	if (name == "greedy")
+		return std::unique_ptr<Policy>(new GreedyPolicy());
+	if (name == "autopilot")
+		return std::unique_ptr<Policy>(new AutopilotPolicy());
+	return nullptr;
+}
@@ -0,0 +1,38 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+// Scripted agents that drive a GameCore, used by the tournament runner to compare autopilots
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core.h"
+
+class Policy {
+public:
+	virtual ~Policy(){}
+	virtual MoveDir nextDir(const GameCore& game) = 0; // Called once per tick, before GameCore::step
+};
+
+// Picks any direction that doesn't end the game this tick, uniformly at random
+class RandomPolicy : public Policy {
+public:
+	RandomPolicy(uint64_t seed): _rng(seed){}
+	MoveDir nextDir(const GameCore& game) override;
+private:
+	Rng _rng;
+};
+
+// Heads straight for the food, only avoiding moves that end the game this tick
+class GreedyPolicy : public Policy {
+public:
+	MoveDir nextDir(const GameCore& game) override;
+};
+
+// Names accepted by makePolicy
+std::vector<std::string> policyNames();
+// Returns nullptr if name isn't a known policy. seed is only used by policies with randomness.
+std::unique_ptr<Policy> makePolicy(const std::string& name, uint64_t seed);
+
+#endif // POLICY_H
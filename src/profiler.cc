@@ -0,0 +1,91 @@
+#include "profiler.h"
+#include "allocs.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+static const char* STAGE_NAMES[NUM_PROF_STAGES] = { "events", "tick", "draw", "text", "wait", "present" };
+
+FrameProfiler::FrameProfiler(): _enabled(false), _freq(SDL_GetPerformanceFrequency()),
+	_frame_start(0), _last_mark(0), _frame_allocs(0), _cur(), _frames(0), _ring(), _head(0), _count(0){
+	for (auto& line : _lines)
+		line[0] = '\0';
+}
+
+void FrameProfiler::setEnabled(bool on){
+	_enabled = on;
+	_frame_start = 0; // Don't count whatever happened while it was off as a frame
+}
+
+void FrameProfiler::newFrame(int draw_calls){
+	if (!_enabled)
+		return;
+	Uint64 now = SDL_GetPerformanceCounter();
+	if (_frame_start != 0){
+		_cur.frame = _frames++;
+		_cur.frame_ms = (now - _frame_start)*1000.0/_freq;
+		_cur.draw_calls = draw_calls;
+		_cur.allocs = allocCount() - _frame_allocs;
+		_ring[_head] = _cur;
+		_head = (_head+1) % PROF_HISTORY;
+		_count = std::min(_count+1, (size_t)PROF_HISTORY);
+		if (_frames % PROF_TEXT_EVERY == 1)
+			updateLines();
+	}
+	_cur = FrameSample();
+	_frame_start = _last_mark = now;
+	_frame_allocs = allocCount();
+}
+
+void FrameProfiler::markNow(ProfStage stage){
+	if (_frame_start == 0)
+		return;
+	Uint64 now = SDL_GetPerformanceCounter();
+	_cur.stage_ms[stage] += (now - _last_mark)*1000.0/_freq;
+	_last_mark = now;
+}
+
+void FrameProfiler::updateLines(){
+	size_t n = std::min(_count, (size_t)PROF_AVG_FRAMES);
+	double frame = 0, max_frame = 0, draws = 0, allocs = 0;
+	double stages[NUM_PROF_STAGES] = {};
+	for (size_t i = _count-n; i < _count; i++){
+		const FrameSample& s = sample(i);
+		frame += s.frame_ms;
+		max_frame = std::max(max_frame, (double)s.frame_ms);
+		for (int j = 0; j < NUM_PROF_STAGES; j++)
+			stages[j] += s.stage_ms[j];
+		draws += s.draw_calls;
+		allocs += s.allocs;
+	}
+
+	snprintf(_lines[0].data(), PROF_LINE_LEN, "FRAME %5.2f ms, MAX %5.2f", frame/n, max_frame);
+	for (int j = 0; j < NUM_PROF_STAGES; j++)
+		snprintf(_lines[j+1].data(), PROF_LINE_LEN, "%-8s %5.2f ms", STAGE_NAMES[j], stages[j]/n);
+	if (allocCountingEnabled())
+		snprintf(_lines[PROF_LINES-1].data(), PROF_LINE_LEN, "DRAWS %.0f, ALLOCS %.1f", draws/n, allocs/n);
+	else
+		snprintf(_lines[PROF_LINES-1].data(), PROF_LINE_LEN, "DRAWS %.0f, ALLOCS n/a", draws/n);
+}
+
+bool FrameProfiler::writeCsv(const std::string& path) const {
+	std::ofstream out(path);
+	if (!out){
+		std::cerr << "File Error: Could not write frame profile to \"" << path << "\"\n";
+		return false;
+	}
+	out << "frame,frame_ms";
+	for (const char* name : STAGE_NAMES)
+		out << "," << name << "_ms";
+	out << ",draw_calls,allocs\n";
+	for (size_t i = 0; i < _count; i++){
+		const FrameSample& s = sample(i);
+		out << s.frame << "," << s.frame_ms;
+		for (float ms : s.stage_ms)
+			out << "," << ms;
+		out << "," << s.draw_calls << "," << s.allocs << "\n";
+	}
+	return true;
+}
@@ -0,0 +1,79 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Frame profiler behind the in-game overlay (F3). A frame is split into stages by calling mark()
+// as each one ends, and the last PROF_HISTORY frames are kept in a ring buffer along with their
+// draw calls and heap allocations. While it's off, every call returns straight away.
+
+#include <SDL2/SDL.h>
+
+#include <array>
+#include <string>
+
+typedef enum ProfStage {
+	PF_EVENTS, // SDL_PollEvent and input handling
+	PF_TICK, // Game ticks, timed on the simulation thread unless it runs between frames
+	PF_DRAW, // Building the frame, apart from...
+	PF_TEXT, // ...rasterizing text the text cache didn't have
+	PF_WAIT, // Frame pacer waiting for the frame to be due
+	PF_PRESENT, // SDL_RenderPresent
+} ProfStage;
+
+#define NUM_PROF_STAGES 6
+#define PROF_HISTORY 600 // Frames kept (10 s at 60 FPS), and what the CSV gets
+#define PROF_AVG_FRAMES 60 // The overlay shows averages over this many frames
+#define PROF_TEXT_EVERY 15 // Frames between overlay text updates, so it isn't new text to rasterize every frame
+#define PROF_LINES (NUM_PROF_STAGES+2) // Overlay text: frame time, one per stage, draw calls and allocations
+#define PROF_LINE_LEN 48
+
+struct FrameSample {
+	uint64_t frame; // Frame number since the profiler was made
+	float frame_ms; // Whole frame, from newFrame to the next newFrame
+	float stage_ms[NUM_PROF_STAGES];
+	int draw_calls;
+	uint32_t allocs;
+};
+
+class FrameProfiler {
+public:
+	FrameProfiler();
+
+	void setEnabled(bool on);
+	bool enabled() const { return _enabled; }
+
+	// Call at the start of every frame. Finishes the previous frame, which made draw_calls draw calls.
+	void newFrame(int draw_calls);
+	// The time since the last mark (or newFrame) was spent in stage
+	void mark(ProfStage stage){ if (_enabled) markNow(stage); }
+	// Time measured some other way, e.g. on another thread
+	void add(ProfStage stage, double ms){ if (_enabled) _cur.stage_ms[stage] += ms; }
+	// Part of the time marked as one stage was really another's
+	void move(ProfStage from, ProfStage to, double ms){
+		if (_enabled){
+			_cur.stage_ms[from] -= ms;
+			_cur.stage_ms[to] += ms;
+		}
+	}
+
+	size_t size() const { return _count; }
+	const FrameSample& sample(size_t i) const { return _ring[(_head + PROF_HISTORY - _count + i) % PROF_HISTORY]; } // 0 is the oldest
+	const char* line(int i) const { return _lines[i].data(); }
+	bool writeCsv(const std::string& path) const;
+
+private:
+	void markNow(ProfStage stage);
+	void updateLines();
+
+	bool _enabled;
+	Uint64 _freq;
+	Uint64 _frame_start, _last_mark; // 0 if no frame is under way
+	uint64_t _frame_allocs; // allocCount() when the frame started
+	FrameSample _cur;
+	uint64_t _frames;
+
+	std::array<FrameSample, PROF_HISTORY> _ring;
+	size_t _head, _count; // Next slot to write, and how many are filled
+	std::array<std::array<char, PROF_LINE_LEN>, PROF_LINES> _lines;
+};
+
+#endif // PROFILER_H
@@ -0,0 +1,235 @@
+#include "replay.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define REPLAY_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+void ReplayWriter::begin(uint64_t seed, int level, int cols, int rows, Cell food, uint32_t keyframe_interval){
+	_header = ReplayHeader();
+	_header.version = REPLAY_VERSION;
+	_header.level = level;
+	_header.cols = cols;
+	_header.rows = rows;
+	_header.seed = seed;
+	_header.keyframe_interval = keyframe_interval;
+	_dirs.clear();
+	_foods.assign(1, food.y*cols + food.x);
+	_kf_ticks.clear();
+	_keyframes.clear();
+
+	_mirror = std::unique_ptr<GameCore>(new GameCore(cols, rows, seed));
+	_mirror->setFood(food);
+	_recording = true;
+}
+
+void ReplayWriter::record(MoveDir dir, bool ate, Cell new_food){
+	if (!_recording)
+		return;
+	uint32_t t = _header.num_ticks++;
+	if (t%4 == 0)
+		_dirs.push_back(0);
+	_dirs.back() |= dir << ((t%4)*2);
+
+	if (ate)
+		_foods.push_back(new_food.y*_header.cols + new_food.x);
+	if (_mirror->step(dir) == SR_ATE)
+		_mirror->setFood(new_food);
+	if (_header.num_ticks % _header.keyframe_interval == 0)
+		addKeyframe();
+}
+
+void ReplayWriter::addKeyframe(){
+	_kf_ticks.push_back(_header.num_ticks);
+	_keyframes.emplace_back();
+	_mirror->serialize(_keyframes.back());
+}
+
+bool ReplayWriter::finish(const std::string& path){
+	_recording = false;
+	_header.num_foods = _foods.size();
+	_header.num_keyframes = _keyframes.size();
+
+	std::vector<uint8_t> out;
+	out.insert(out.end(), REPLAY_MAGIC, REPLAY_MAGIC+4);
+	put16(out, _header.version);
+	out.push_back(_header.level);
+	out.push_back(0); // Reserved
+	put16(out, _header.cols);
+	put16(out, _header.rows);
+	put32(out, _header.seed);
+	put32(out, _header.seed >> 32);
+	put32(out, _header.num_ticks);
+	put32(out, _header.keyframe_interval);
+	put32(out, _header.num_foods);
+	put32(out, _header.num_keyframes);
+
+	out.insert(out.end(), _dirs.begin(), _dirs.end());
+	for (CellIndex c : _foods)
+		put16(out, c);
+
+	uint32_t offset = out.size() + _keyframes.size()*12;
+	for (size_t i = 0; i < _keyframes.size(); i++){
+		put32(out, _kf_ticks[i]);
+		put32(out, offset);
+		put32(out, _keyframes[i].size());
+		offset += _keyframes[i].size();
+	}
+	for (const std::vector<uint8_t>& kf : _keyframes)
+		out.insert(out.end(), kf.begin(), kf.end());
+
+	std::ofstream ofs(path, std::ios::out | std::ios::binary);
+	if (!ofs){
+		std::cerr << "File Error: Failed to create replay file \"" << path << "\"\n";
+		return false;
+	}
+	ofs.write(reinterpret_cast<const char*>(out.data()), out.size());
+	return (bool)ofs;
+}
+
+bool Replay::open(const std::string& path){
+	close();
+#ifdef REPLAY_MMAP
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0){
+		void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED){
+			_data = (const uint8_t*)p;
+			_size = st.st_size;
+			_mapped = true;
+		}
+	}
+	::close(fd);
+#endif
+	if (!_mapped){
+		std::ifstream ifs(path, std::ios::in | std::ios::binary);
+		if (!ifs)
+			return false;
+		_buffer.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+		_data = _buffer.data();
+		_size = _buffer.size();
+	}
+
+	if (_size < REPLAY_HEADER_SIZE || memcmp(_data, REPLAY_MAGIC, 4) != 0){
+		close();
+		return false;
+	}
+	_header.version = get16(_data+4);
+	_header.level = _data[6];
+	_header.cols = get16(_data+8);
+	_header.rows = get16(_data+10);
+	_header.seed = get32(_data+12) | ((uint64_t)get32(_data+16) << 32);
+	_header.num_ticks = get32(_data+20);
+	_header.keyframe_interval = get32(_data+24);
+	_header.num_foods = get32(_data+28);
+	_header.num_keyframes = get32(_data+32);
+
+	if (!validate()){
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool Replay::validate(){
+	if (_header.version != REPLAY_VERSION || _header.cols == 0 || _header.rows == 0
+			|| (size_t)_header.cols*_header.rows > 65536 || _header.num_foods == 0)
+		return false;
+	size_t cells = (size_t)_header.cols*_header.rows;
+	// Sizes in size_t, so a huge count can't wrap a pointer back into the file
+	size_t dirs_at = REPLAY_HEADER_SIZE;
+	size_t foods_at = dirs_at + ((size_t)_header.num_ticks+3)/4;
+	size_t index_at = foods_at + (size_t)_header.num_foods*2;
+	if (index_at + (size_t)_header.num_keyframes*12 > _size)
+		return false;
+	_dirs = _data + dirs_at;
+	_foods = _data + foods_at;
+	_kf_index = _data + index_at;
+
+	// Every food has to be on the board
+	for (uint32_t i = 0; i < _header.num_foods; i++){
+		if (get16(_foods + i*2) >= cells)
+			return false;
+	}
+
+	// Keyframes in tick order, inside the file, and each one a state a game can be in
+	GameCore scratch(_header.cols, _header.rows);
+	uint32_t last_tick = 0;
+	for (uint32_t i = 0; i < _header.num_keyframes; i++){
+		const uint8_t* entry = _kf_index + i*12;
+		uint32_t kf_tick = get32(entry), offset = get32(entry+4), size = get32(entry+8);
+		if (kf_tick > _header.num_ticks || (i > 0 && kf_tick <= last_tick)
+				|| (size_t)offset + size > _size || !scratch.deserialize(_data + offset, size)
+				|| scratch.getTick() != kf_tick)
+			return false;
+		last_tick = kf_tick;
+	}
+	return true;
+}
+
+void Replay::close(){
+#ifdef REPLAY_MMAP
+	if (_mapped)
+		munmap((void*)_data, _size);
+#endif
+	_buffer.clear();
+	_header = ReplayHeader();
+	_data = nullptr;
+	_size = 0;
+	_mapped = false;
+}
+
+std::unique_ptr<GameCore> Replay::newGame() const {
+	std::unique_ptr<GameCore> game(new GameCore(_header.cols, _header.rows, _header.seed));
+	if (_header.num_foods > 0) // Only when nothing is open
+		game->setFood(game->toCell(get16(_foods)));
+	return game;
+}
+
+bool Replay::stepGame(GameCore& game) const {
+	uint32_t t = game.getTick();
+	if (t >= _header.num_ticks || game.isGameOver())
+		return false;
+	// Food number n is the one that appears after eating n apples
+	if (game.step(dirAt(t)) == SR_ATE && game.score() < (int)_header.num_foods)
+		game.setFood(game.toCell(get16(_foods + game.score()*2)));
+	return true;
+}
+
+void Replay::seek(GameCore& game, uint32_t tick) const {
+	tick = std::min(tick, _header.num_ticks);
+
+	// Last keyframe at or before tick (keyframes are stored in tick order)
+	int lo = 0, hi = _header.num_keyframes;
+	while (lo < hi){
+		int mid = (lo+hi)/2;
+		if (get32(_kf_index + mid*12) <= tick)
+			lo = mid+1;
+		else
+			hi = mid;
+	}
+
+	bool backwards = game.getTick() > tick || game.cols() != _header.cols || game.rows() != _header.rows;
+	bool restored = false;
+	if (lo > 0){
+		const uint8_t* entry = _kf_index + (lo-1)*12;
+		uint32_t kf_tick = get32(entry), offset = get32(entry+4), size = get32(entry+8);
+		// Only worth it if the keyframe is ahead of where the game already is
+		if (backwards || kf_tick > game.getTick())
+			restored = game.deserialize(_data + offset, size);
+	}
+	if (backwards && !restored)
+		game = *newGame();
+
+	while (game.getTick() < tick && stepGame(game));
+}
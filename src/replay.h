@@ -0,0 +1,104 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+// Replay files: the seed, the level and one 2-bit direction per tick, plus every food spawn
+// (2 bytes per apple) so playback never depends on the RNG. Keyframes of the full board state
+// every REPLAY_KEYFRAME_INTERVAL ticks let a viewer seek without simulating from the start.
+// A 10,000 tick game is roughly 3 KB.
+//
+// Layout (little-endian):
+//   header (REPLAY_HEADER_SIZE bytes, see ReplayHeader)
+//   directions, 4 per byte, low bits first
+//   food cells, CellIndex each (initial food, then one per apple eaten)
+//   keyframe index, (tick, offset, size) as 3 uint32 each, offsets from the start of the file
+//   keyframes, each a GameCore::serialize blob
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core.h"
+
+#define REPLAY_MAGIC "SNRP"
+#define REPLAY_VERSION 1
+#define REPLAY_HEADER_SIZE 36
+#define REPLAY_KEYFRAME_INTERVAL 4096
+
+struct ReplayHeader {
+	uint16_t version;
+	uint8_t level;
+	uint16_t cols, rows;
+	uint64_t seed;
+	uint32_t num_ticks;
+	uint32_t keyframe_interval;
+	uint32_t num_foods;
+	uint32_t num_keyframes;
+};
+
+// Records a game tick by tick. Keeps a GameCore mirror of the game fed with the same directions
+// and food, which is where the keyframes come from.
+class ReplayWriter {
+public:
+	ReplayWriter(): _mirror(nullptr), _recording(false){}
+
+	// Start a new recording. food is where the food was put when the game was reset.
+	void begin(uint64_t seed, int level, int cols, int rows, Cell food,
+			uint32_t keyframe_interval=REPLAY_KEYFRAME_INTERVAL);
+	// Call once per game tick with the direction the snake moved in. If it ate this tick,
+	// new_food is where the food respawned.
+	void record(MoveDir dir, bool ate, Cell new_food);
+	// Writes the replay to path and stops recording. Returns false if the file couldn't be written.
+	bool finish(const std::string& path);
+
+	bool isRecording() const { return _recording; }
+	uint32_t numTicks() const { return _header.num_ticks; }
+
+private:
+	void addKeyframe();
+
+	ReplayHeader _header;
+	std::unique_ptr<GameCore> _mirror;
+	bool _recording;
+	std::vector<uint8_t> _dirs;
+	std::vector<CellIndex> _foods;
+	std::vector<uint32_t> _kf_ticks;
+	std::vector<std::vector<uint8_t>> _keyframes;
+};
+
+// Read-only view of a replay file. The file is memory-mapped where the platform allows it,
+// otherwise read into memory.
+class Replay {
+public:
+	Replay(): _data(nullptr), _size(0), _mapped(false), _header(){}
+	~Replay(){ close(); }
+	Replay(const Replay&) = delete;
+	Replay& operator=(const Replay&) = delete;
+
+	bool open(const std::string& path); // Returns false if the file is missing or not a valid replay
+	void close();
+
+	const ReplayHeader& header() const { return _header; }
+	uint32_t numTicks() const { return _header.num_ticks; }
+	MoveDir dirAt(uint32_t tick) const { return (MoveDir)((_dirs[tick/4] >> ((tick%4)*2)) & 3); }
+
+	// A fresh game matching this replay's board, seed and starting food
+	std::unique_ptr<GameCore> newGame() const;
+	// Advance game by one recorded tick. Returns false at the end of the replay.
+	bool stepGame(GameCore& game) const;
+	// Put game in the state it was in after `tick` ticks, starting from the nearest keyframe
+	void seek(GameCore& game, uint32_t tick) const;
+
+private:
+	bool validate(); // Checks the header, food log and keyframes, and points _dirs etc. into the file
+
+	const uint8_t* _data;
+	size_t _size;
+	bool _mapped;
+	std::vector<uint8_t> _buffer; // Only used when the file couldn't be memory-mapped
+	ReplayHeader _header;
+	const uint8_t* _dirs;
+	const uint8_t* _foods;
+	const uint8_t* _kf_index;
+};
+
+#endif // REPLAY_H
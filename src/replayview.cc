@@ -0,0 +1,80 @@
+#include "replayview.h"
+#include "simclock.h"
+
+void runReplay(GFX* gfx, const std::string& path){
+	Replay replay;
+	if (!replay.open(path)){
+		std::cerr << "Error: \"" << path << "\" is not a valid replay file.\n";
+		return;
+	}
+	std::unique_ptr<GameCore> game = replay.newGame();
+	int level = replay.header().level;
+	double hz = (level >= 1 && level <= NUM_DIFFS) ? level_hz[level-1] : FPS;
+	uint32_t seek_step = 5*hz; // 5 seconds of game time
+	SimClock clock(hz);
+	std::cout << "Playing replay \"" << path << "\" (level " << level << ", seed " << replay.header().seed
+		<< ", " << replay.numTicks() << " ticks)\n";
+
+	bool running = true, paused = false, fast = false;
+	while (running){
+		SDL_Event event;
+		while (SDL_PollEvent(&event)){
+			if (event.type == SDL_QUIT)
+				running = false;
+			if (event.type != SDL_KEYDOWN)
+				continue;
+			uint32_t tick = game->getTick();
+			switch(event.key.keysym.sym){
+				case SDLK_ESCAPE:
+					running = false;
+					break;
+				case SDLK_SPACE:
+					paused = !paused;
+					break;
+				case SDLK_f:
+					fast = !fast;
+					break;
+				case SDLK_LEFT:
+					replay.seek(*game, (tick > seek_step) ? tick-seek_step : 0);
+					break;
+				case SDLK_RIGHT:
+					replay.seek(*game, tick+seek_step);
+					break;
+				case SDLK_HOME:
+					replay.seek(*game, 0);
+					break;
+				case SDLK_END:
+					replay.seek(*game, replay.numTicks());
+					break;
+			}
+		}
+
+		// Fast-forward is the clock's turbo mode, as many ticks as fit in a frame
+		clock.setTurbo(fast);
+		if (paused){
+			clock.restart();
+		} else {
+			int due = clock.advance();
+			for (int i = 0; i < due && clock.frameTimeLeft() && replay.stepGame(*game); i++);
+		}
+
+		gfx->renderClear();
+		renderReplayFrame(gfx, replay, *game, paused ? " PAUSED" : fast ? " FAST" : "");
+		gfx->renderPresent();
+	}
+}
+
+void renderReplayFrame(const GFX* gfx, const Replay& replay, const GameCore& game, const char* status){
+	gfx->renderGame(game);
+	char text[64];
+	snprintf(text, sizeof(text), "SCORE: %d", game.score());
+	gfx->renderText(text,
+			(GRID_CELL_SIZE/2), (GRID_CELL_SIZE/2),
+			WHITE, F_SMALL
+	);
+	snprintf(text, sizeof(text), "REPLAY %llu/%u%s", (unsigned long long)game.getTick(), replay.numTicks(), status);
+	gfx->renderText(text,
+			(GRID_CELL_SIZE), (SCREEN_H-(GRID_CELL_SIZE*2)),
+			WHITE, F_SMALL
+	);
+}
@@ -0,0 +1,15 @@
+#ifndef REPLAYVIEW_H
+#define REPLAYVIEW_H
+
+#include "graphics.h"
+#include "replay.h"
+
+// Plays back a replay file in the game window until the user quits.
+// SPACE pauses, LEFT/RIGHT scrub 5 seconds, HOME/END jump to the start/end, F toggles uncapped fast-forward.
+void runReplay(GFX* gfx, const std::string& path);
+
+// Draws one frame of a replay: the board, the score and the tick counter followed by status
+// (e.g. " PAUSED"). Doesn't clear or present.
+void renderReplayFrame(const GFX* gfx, const Replay& replay, const GameCore& game, const char* status);
+
+#endif // REPLAYVIEW_H
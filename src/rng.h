@@ -0,0 +1,62 @@
+#ifndef RNG_H
+#define RNG_H
+
+// Small, fast per-game random number generator (xoshiro128++, 16 bytes of state).
+// Every game owns one with an explicit seed, so parallel sims never share libc's rand() state
+// and any game can be replayed from its seed.
+
+#include <cstdint>
+
+// splitmix64 step, used to expand a seed into generator state and to mix seeds together
+inline uint64_t splitMix64(uint64_t x){
+	x += 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+class Rng {
+public:
+	Rng(uint64_t seed=0){ setSeed(seed); }
+
+	void setSeed(uint64_t seed){
+		uint64_t a = splitMix64(seed), b = splitMix64(a);
+		_s[0] = a; _s[1] = a >> 32;
+		_s[2] = b; _s[3] = b >> 32;
+		if (!(_s[0] | _s[1] | _s[2] | _s[3]))
+			_s[0] = 1; // All-zero state would only ever produce zeros
+	}
+
+	uint32_t next(){
+		uint32_t res = rotl(_s[0] + _s[3], 7) + _s[0];
+		uint32_t t = _s[1] << 9;
+		_s[2] ^= _s[0];
+		_s[3] ^= _s[1];
+		_s[1] ^= _s[2];
+		_s[0] ^= _s[3];
+		_s[2] ^= t;
+		_s[3] = rotl(_s[3], 11);
+		return res;
+	}
+	uint32_t operator()(){ return next(); }
+
+	// Uniform number in [0, n) without the bias of next() % n (Lemire's multiply-and-reject)
+	uint32_t bounded(uint32_t n){
+		uint64_t m = (uint64_t)next() * n;
+		uint32_t low = (uint32_t)m;
+		if (low < n){
+			uint32_t threshold = -n % n;
+			while (low < threshold){
+				m = (uint64_t)next() * n;
+				low = (uint32_t)m;
+			}
+		}
+		return m >> 32;
+	}
+
+private:
+	static uint32_t rotl(uint32_t x, int k){ return (x << k) | (x >> (32-k)); }
+	uint32_t _s[4];
+};
+
+#endif // RNG_H
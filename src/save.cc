@@ -1,4 +1,5 @@
 #include "save.h"
+#include "trace.h"
 
 #ifdef EMSCRIPTEN
 #include <emscripten.h>
@@ -43,6 +44,7 @@ void syncFS(bool populate) {
 
 // Creates new save file and initializes empty SaveData struct if save file did not exist
 void saveInit(){
+	TRACE_ZONE("saveInit");
 	#ifdef EMSCRIPTEN
 	mountIDBFS();
 	syncFS(true);
@@ -67,6 +69,7 @@ void saveInit(){
 
 // Returns the high score of the specified level
 int getHighScore(int level){ 
+	TRACE_ZONE("getHighScore");
 	int score = 0;	
 	std::ifstream ifs;
 	ifs.open(SAVE_PATH, std::fstream::in | std::fstream::binary);
@@ -83,6 +86,7 @@ int getHighScore(int level){
 // After game over, checks score for the level, and updates save data 
 // if score is higher than before
 void saveUpdate(int level, int score){
+	TRACE_ZONE("saveUpdate");
 	std::fstream fs;
 	fs.open(SAVE_PATH, std::fstream::in | std::fstream::out | std::fstream::binary);
 	int high_score = 0;
@@ -107,6 +111,7 @@ void saveUpdate(int level, int score){
 
 // Returns SaveData struct if load was successful
 std::unique_ptr<SaveData> saveLoad(){
+	TRACE_ZONE("saveLoad");
 	#ifdef EMSCRIPTEN
 	mountIDBFS();
 	syncFS(true);
@@ -0,0 +1,51 @@
+#include "simclock.h"
+
+#include <climits>
+
+SimClock::SimClock(double hz): _turbo(false), _freq(SDL_GetPerformanceFrequency()), _frame_end(0){
+	setRate(hz);
+	restart();
+}
+
+void SimClock::setRate(double hz){
+	_hz = hz;
+	_tick_len = (Uint64)(_freq/hz);
+	if (_tick_len == 0)
+		_tick_len = 1;
+}
+
+void SimClock::restart(){
+	_last = SDL_GetPerformanceCounter();
+	_acc = _tick_len;
+}
+
+int SimClock::advance(){
+	Uint64 now = SDL_GetPerformanceCounter();
+	_acc += now - _last;
+	_last = now;
+	if (_turbo){
+		_acc = 0;
+		_frame_end = now + _freq*SIM_TURBO_FRAME_MS/1000;
+		return INT_MAX;
+	}
+
+	Uint64 due = _acc/_tick_len;
+	if (due > SIM_MAX_TICKS_PER_FRAME){
+		due = SIM_MAX_TICKS_PER_FRAME;
+		_acc = 0; // Drop the backlog instead of fast-forwarding through it
+	} else {
+		_acc -= due*_tick_len;
+	}
+	return due;
+}
+
+bool SimClock::frameTimeLeft() const {
+	return !_turbo || SDL_GetPerformanceCounter() < _frame_end;
+}
+
+Uint32 SimClock::msToNextTick() const {
+	Uint64 waited = _acc + (SDL_GetPerformanceCounter() - _last);
+	if (_turbo || waited >= _tick_len)
+		return 0;
+	return (Uint32)((_tick_len - waited)*1000/_freq);
+}
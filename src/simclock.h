@@ -0,0 +1,45 @@
+#ifndef SIMCLOCK_H
+#define SIMCLOCK_H
+
+// Fixed-timestep game clock. Real time (from SDL_GetPerformanceCounter) piles up in an accumulator
+// and is paid out in whole ticks of 1/rate seconds, so the game runs at its tick rate no matter how
+// long frames take: several ticks in one frame when the rate is above the refresh rate, none in
+// frames that come early. In turbo mode it ignores the rate and ticks for as long as a frame allows.
+
+#include <SDL2/SDL.h>
+
+#define SIM_MAX_TICKS_PER_FRAME 10 // Catch-up limit, a longer backlog (e.g. a stalled window) is dropped
+#define SIM_TURBO_FRAME_MS 12 // Time per frame spent ticking in turbo mode, the rest is left for rendering
+
+class SimClock {
+public:
+	SimClock(double hz);
+
+	void setRate(double hz); // Ticks per second
+	double getRate() const { return _hz; }
+	void setTurbo(bool on){ _turbo = on; }
+	bool isTurbo() const { return _turbo; }
+
+	// Start timing from now with one tick due straight away, e.g. once a countdown finishes
+	void restart();
+	// Number of ticks due since the last call, at most SIM_MAX_TICKS_PER_FRAME.
+	// In turbo mode there's no limit, tick while frameTimeLeft() is true instead.
+	int advance();
+	// Always true unless in turbo mode and this frame's SIM_TURBO_FRAME_MS have been used up
+	bool frameTimeLeft() const;
+	// Milliseconds (rounded down) until the next tick is due, for a thread that can sleep till then
+	Uint32 msToNextTick() const;
+	// How far the accumulator is into the next tick, from 0 to 1
+	double alpha() const { return (double)_acc/_tick_len; }
+
+private:
+	double _hz;
+	bool _turbo;
+	Uint64 _freq; // Performance counter ticks per second
+	Uint64 _tick_len; // One game tick, in performance counter ticks
+	Uint64 _last; // Counter value at the previous advance()
+	Uint64 _acc;
+	Uint64 _frame_end; // Turbo mode deadline for the current frame
+};
+
+#endif // SIMCLOCK_H
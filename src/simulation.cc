@@ -0,0 +1,177 @@
+#include "simulation.h"
+
+Simulation::Simulation(int cols, int rows, uint64_t session_seed, int plan_budget, double tick_hz,
+		bool log_input, const std::string& record_dir):
+	_cols(cols), _rows(rows), _dim(SCREEN_W/cols),
+	_session_seed(session_seed), _game_seed(0), _game_num(0),
+	_tick_hz(tick_hz), _log_input(log_input), _level(1), _autopilot_on(false),
+	_game(new GameCore(cols, rows)), _autopilot(plan_budget),
+	_record_dir(record_dir), _clock(FPS), // The real rate comes with SC_RUN
+	_state(SS_IDLE), _tick(0), _death(), _won(false), _self_hit(false), _eaten(0), _tick_ms(0), _published(0),
+	_quit(false) {
+	if (!record_dir.empty())
+		_recorder = std::unique_ptr<ReplayWriter>(new ReplayWriter());
+	newGame();
+	publish(); // So there's something to draw before the first pump
+}
+
+void Simulation::start(){
+	_thread = std::thread(&Simulation::run, this);
+}
+
+void Simulation::stop(){
+	if (!_thread.joinable())
+		return;
+	_quit.store(true, std::memory_order_relaxed);
+	_thread.join();
+}
+
+void Simulation::run(){
+	traceThreadName("simulation");
+	while (!_quit.load(std::memory_order_relaxed)){
+		pump();
+		if (_state == SS_RUNNING && _clock.isTurbo())
+			continue; // Flat out
+		Uint32 ms = SIM_POLL_MS;
+		if (_state == SS_RUNNING)
+			ms = std::min(ms, _clock.msToNextTick());
+		if (ms > 0)
+			SDL_Delay(ms);
+		else
+			std::this_thread::yield();
+	}
+}
+
+void Simulation::pump(){
+	bool changed = false;
+	SimCommand cmd;
+	while (_commands.pop(cmd)){
+		handle(cmd);
+		changed = true;
+	}
+
+	if (_state == SS_RUNNING){
+		Uint64 start = SDL_GetPerformanceCounter();
+		int ticks_due = _clock.advance(), t = 0;
+		for (; t < ticks_due && _clock.frameTimeLeft() && _state == SS_RUNNING; t++)
+			tick();
+		if (t > 0){
+			_tick_ms += (SDL_GetPerformanceCounter() - start)*1000.0/SDL_GetPerformanceFrequency();
+			changed = true;
+		}
+	}
+	if (changed)
+		publish();
+}
+
+void Simulation::handle(const SimCommand& cmd){
+	switch(cmd.type){
+		case SC_TURN:
+			_controls.queueDir(cmd.dir, cmd.timestamp, _game->getDir());
+			break;
+		case SC_RUN:
+			if (_state == SS_OVER)
+				break;
+			_level = cmd.level;
+			_autopilot_on = cmd.autopilot;
+			_clock.setRate(_tick_hz > 0 ? _tick_hz : cmd.hz);
+			_clock.restart();
+			_state = SS_RUNNING;
+			break;
+		case SC_HOLD:
+			if (_state == SS_RUNNING)
+				_state = SS_IDLE;
+			break;
+		case SC_TURBO:
+			_clock.setTurbo(cmd.on);
+			break;
+		case SC_NEW_GAME:
+			finishRecording(); // Player quit to the main menu mid-game
+			newGame();
+			break;
+	}
+}
+
+// Reseed and reset the game. Each game gets its own seed (derived from the session seed)
+// so that it can be replayed on its own.
+void Simulation::newGame(){
+	TRACE_ZONE("Simulation::newGame");
+	_game_seed = splitMix64(_session_seed + _game_num++);
+	_game->setSeed(_game_seed);
+	_game->reset();
+	_controls.reset();
+	_autopilot.resetStats();
+	_state = SS_IDLE;
+	_tick = 0;
+	_won = _self_hit = false;
+	_eaten = 0;
+}
+
+// Write out the game being recorded, if any
+void Simulation::finishRecording(){
+	if (!_recorder || !_recorder->isRecording())
+		return;
+	TRACE_ZONE("save replay");
+	std::string path = _record_dir + "/replay-" + std::to_string(_game_seed) + ".snrp";
+	if (_recorder->finish(path))
+		std::cout << "Saved replay to " << path << "\n";
+}
+
+// Everything in here is the "game tick"
+void Simulation::tick(){
+	TRACE_ZONE("tick");
+	if (_recorder && !_recorder->isRecording())
+		_recorder->begin(_game_seed, _level, _cols, _rows, _game->getFood());
+	_death = _game->getHead(); // If this tick ends the game, it's marked where the head was
+
+	// The autopilot picks this tick's move before anything happens, like a player would
+	if (_autopilot_on)
+		_game->setBuffDir(_autopilot.nextDir(*_game));
+	int latency = _controls.applyNext(*_game); // Take the next queued turn
+	if (_log_input && latency >= 0)
+		std::cout << "Turn applied " << latency << " ms after the key press\n";
+
+	// The game can eat and end in the same tick, so eating is told by the score
+	int score = _game->score();
+	StepResult res = _game->step();
+	bool ate = _game->score() > score;
+	if (ate)
+		_eaten++;
+	if (_recorder)
+		_recorder->record(_game->getDir(), ate, _game->getFood());
+	_won = (res == SR_WON);
+	_self_hit = (res == SR_HIT_SELF);
+	bool over = _game->isGameOver();
+	_tick++;
+
+	if (over){
+		_state = SS_OVER;
+		finishRecording();
+	}
+}
+
+void Simulation::publish(){
+	FrameSnapshot& snap = _frames.back();
+	snap.seq = _published++;
+	snap.state = _state;
+	snap.game_seed = _game_seed;
+	snap.tick = _tick;
+	snap.cols = _cols;
+	snap.dim = _dim;
+	snap.head = _game->getHead();
+	snap.food = _game->getFood();
+	snap.death = _death;
+	snap.won = _won;
+	snap.self_hit = _self_hit;
+	snap.eaten = _eaten;
+	snap.length = _game->length();
+	const BodyRing& body = _game->getBody();
+	snap.body_len = body.size();
+	for (size_t i = 0; i < body.size(); i++)
+		snap.body[i] = body[i];
+	snap.input = _controls.inputStats();
+	snap.plan = _autopilot.stats();
+	snap.tick_ms = _tick_ms;
+	_tick_ms = 0;
+	_frames.publish();
+}
@@ -0,0 +1,132 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+// The game simulation on its own thread, so ticks keep their rate however long frames take and a
+// slow tick (e.g. the autopilot planning on a big board) doesn't hold up rendering.
+// The main thread sends commands (turns, start/stop, new game) through a lock-free queue, and the
+// simulation publishes a FrameSnapshot after every batch of ticks through a triple buffer, which is
+// all the renderer ever reads. Neither side waits on the other.
+// Builds without threads (the web build, or --single-thread) call pump() once a frame instead.
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "snake.h"
+#include "autopilot.h"
+#include "replay.h"
+#include "simclock.h"
+#include "geometry.h"
+#include "handoff.h"
+
+#define SIM_QUEUE_LEN 64 // Commands in flight, far more than a frame's worth of key presses
+#define SIM_POLL_MS 1 // Longest the thread sleeps before checking for commands
+
+typedef enum SimCommandType {
+	SC_TURN, // Queue a turn (dir, timestamp)
+	SC_RUN, // Start or resume ticking at hz (level, autopilot)
+	SC_HOLD, // Stop ticking, e.g. paused
+	SC_TURBO, // Turbo mode on or off (on)
+	SC_NEW_GAME, // Reset for the next game, the old one is over or was abandoned
+} SimCommandType;
+
+struct SimCommand {
+	SimCommandType type;
+	MoveDir dir;
+	Uint32 timestamp;
+	double hz;
+	int level;
+	bool autopilot, on;
+
+	static SimCommand turn(MoveDir dir, Uint32 timestamp){ SimCommand c = make(SC_TURN); c.dir = dir; c.timestamp = timestamp; return c; }
+	static SimCommand run(double hz, int level, bool autopilot){ SimCommand c = make(SC_RUN); c.hz = hz; c.level = level; c.autopilot = autopilot; return c; }
+	static SimCommand hold(){ return make(SC_HOLD); }
+	static SimCommand turbo(bool on){ SimCommand c = make(SC_TURBO); c.on = on; return c; }
+	static SimCommand newGame(){ return make(SC_NEW_GAME); }
+
+private:
+	static SimCommand make(SimCommandType type){ SimCommand c = SimCommand(); c.type = type; return c; }
+};
+
+typedef enum SimState {
+	SS_IDLE, // Waiting to be told to run
+	SS_RUNNING,
+	SS_OVER, // The game ended, waiting for SC_NEW_GAME
+} SimState;
+
+// Everything the main thread needs to draw a frame and react to the game
+struct FrameSnapshot {
+	uint64_t seq; // Counts up with every snapshot published
+	SimState state;
+	uint64_t game_seed;
+	uint64_t tick;
+	int cols, dim;
+	Cell head, food;
+	Cell death; // Where the head was on the tick the game ended
+	bool won, self_hit; // How it ended
+	uint32_t eaten; // Apples eaten this game, goes up by one for every apple
+	size_t length; // Snake length, head included
+	size_t body_len;
+	InputStats input;
+	PlanStats plan;
+	double tick_ms; // Time spent on the ticks since the previous snapshot
+	std::array<CellIndex, LargeBoard::CELLS> body; // First body_len are used
+};
+
+class Simulation {
+public:
+	Simulation(int cols, int rows, uint64_t session_seed, int plan_budget, double tick_hz,
+		bool log_input, const std::string& record_dir);
+	~Simulation(){ stop(); }
+	Simulation(const Simulation&) = delete;
+	Simulation& operator=(const Simulation&) = delete;
+
+	void start(); // Run on a thread of its own
+	void stop(); // Stop and join the thread, if there is one
+	// Run whatever is due now: commands, ticks, then a snapshot. Only call this if start() wasn't.
+	void pump();
+
+	// Main thread side. send() returns false if the queue is full.
+	bool send(const SimCommand& cmd){ return _commands.push(cmd); }
+	// The newest snapshot. It stays valid and unchanged until the next call.
+	const FrameSnapshot& latest(){ _frames.update(); return _frames.front(); }
+
+private:
+	void run();
+	void handle(const SimCommand& cmd);
+	void tick();
+	void newGame();
+	void finishRecording();
+	void publish();
+
+	int _cols, _rows, _dim;
+	uint64_t _session_seed, _game_seed, _game_num;
+	double _tick_hz; // Overrides the level's tick rate if set
+	bool _log_input;
+	int _level;
+	bool _autopilot_on;
+
+	std::unique_ptr<GameCore> _game;
+	SnakeControls _controls; // The player's turns
+	AutopilotPolicy _autopilot;
+	std::unique_ptr<ReplayWriter> _recorder; // Only allocated when recording
+	std::string _record_dir;
+	SimClock _clock;
+
+	SimState _state;
+	uint64_t _tick;
+	Cell _death;
+	bool _won, _self_hit;
+	uint32_t _eaten;
+	double _tick_ms;
+	uint64_t _published;
+
+	SpscQueue<SimCommand, SIM_QUEUE_LEN> _commands;
+	TripleBuffer<FrameSnapshot> _frames; // Three board-sized snapshots, so allocate a Simulation with new
+	std::thread _thread;
+	std::atomic<bool> _quit;
+};
+
+#endif // SIMULATION_H
@@ -3,65 +3,44 @@
 
 #include "globals.h"
 
-class Food;
+#define INPUT_QUEUE_LEN 4 // Turns a snake can have lined up, further presses before the next tick are dropped
 
-class Snake {
-public:
-	Snake(int x, int y, int dim, unsigned long color): 
-		_length(1), _dim(dim), _buff_dir(M_RIGHT), _dir(M_RIGHT), 
-		_head({.x=x,.y=y,.w=dim,.h=dim}), _color(hexToColor(color)){}
-
-	void handleMovement();
-
-	// The buffer to store snake direction between game ticks
-	void setBuffDir(MoveDir new_dir);
-	// Snake's real direction, should only update during game tick
-	void updateDir(){ _dir = _buff_dir; }
-	void reset();
-	void handleEatEvents(Food* food); // handle events that trigger after eating food 
-	
-	// Checks if snake's head collided with any parts of its body. 
-	// Returns nullptr upon no collision. Otherwise, returns a rect containing the position of the collision
-	SDL_Rect* checkSnakeCollision(); 
-
-	void printInfo(); // For debugging purposes
-
-	// Returns true if any part of the snake's head/body collides with food.
-	// Used to respawn food again if the food happens to spawn on top of the snake
-	bool collidesWithFood(Food food) const; 
+// A direction key press waiting for its tick
+struct QueuedInput {
+	MoveDir dir;
+	Uint32 timestamp; // SDL event timestamp (ms, same clock as SDL_GetTicks)
+};
 
-	std::deque<SDL_Rect> getBody() const { return _body; }
-	size_t length() const { return _length; } // Get length of snake
-	size_t size() const { return _length; } // Same as length()
-	SDL_Rect* getHead(){ return &_head; } // Get snake's head rect
-	SDL_Color getColor() const { return _color; } // Get color of snake
-	
-private:
+// Time between key presses and the ticks that applied them
+struct InputStats {
+	uint64_t applied, dropped; // dropped counts presses that came in with the queue full
+	double total_ms, max_ms;
 
-	int _length; // length of snake
-	int _dim; // dimensions of snake (cell is square, so only one parameter for width/height is needed)
-	MoveDir _buff_dir; // Buffer direction (To store snake's direction in between frames)
-	MoveDir _dir; // Actual direction (The direction that the snake will actually travel too during game tick
-	SDL_Rect _head; // position of snake head 
-	std::deque<SDL_Rect> _body; // positions of the rest of the snake
-	SDL_Color _color;
+	double meanMs() const { return applied ? total_ms/applied : 0; }
 };
 
-
-class Food {
+// The player's hold on the snake: turns pressed between ticks wait here for the tick that takes
+// them. The snake itself (body, food and the rules) is a GameCore, the same one the autopilot,
+// replays and tournaments play.
+class SnakeControls {
 public:
-	Food(int x, int y, int dim, unsigned long color): 
-		_pos({.w=dim,.h=dim}), _color(hexToColor(color)){ setRandPos(); }
+	SnakeControls(): _queue_head(0), _queue_len(0), _input_stats(){}
+
+	void reset(); // Drop any queued turns and the stats, for a new game
 
-	SDL_Color getColor(){ return _color; }
-	SDL_Rect getPos(){ return _pos; }
-	
-	void setRandPos(); // Generates food at random position
-	void setPos(int x, int y){ _pos.x=x, _pos.y=y; } // For debugging, should not be used in final game
+	// Queue a player's turn, one is taken per tick so quick presses between ticks aren't lost.
+	// Turns back the way the snake (going dir, or the last queued turn) is going, and repeats
+	// of it, are ignored.
+	void queueDir(MoveDir new_dir, Uint32 timestamp, MoveDir dir);
+	// Call at the start of a game tick. Buffers the next queued turn, if any, in game. Returns how
+	// long (ms) that turn was queued for, or -1 if there wasn't one.
+	int applyNext(GameCore& game);
+	const InputStats& inputStats() const { return _input_stats; }
 
 private:
-	SDL_Rect _pos;
-	SDL_Color _color;
+	std::array<QueuedInput, INPUT_QUEUE_LEN> _queue; // Ring buffer of turns waiting for a tick
+	int _queue_head, _queue_len;
+	InputStats _input_stats;
 };
 
 #endif // SNAKE_H
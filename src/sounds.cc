@@ -1,4 +1,5 @@
 #include "sounds.h"
+#include "assets.h"
 
 const int VOLUME_LEVEL = 32;
 
@@ -9,6 +10,12 @@ Mix_Chunk *SoundMaster::getSound(SoundType sound_type) {
   return _bank[sound_type];
 }
 
+void SoundMaster::play(SoundType sound_type) {
+  TRACE_ZONE("play sound");
+  if (!_muted && getSound(sound_type))
+    Mix_PlayChannel(-1, getSound(sound_type), 0);
+}
+
 SoundMaster::SoundMaster() : _muted(false) {
   for (Mix_Chunk *&mc : _bank)
     mc = nullptr;
@@ -25,39 +32,22 @@ SoundMaster::~SoundMaster() {
   Mix_Quit();
 }
 
-bool SoundMaster::loadSounds() { // Returns false if any sounds failed to load
-  _bank[S_EAT] = Mix_LoadWAV(SND_PATH_EAT);
-  if (!_bank[S_EAT]) {
-    std::cerr << "Error: Failed to load \"" << SND_PATH_EAT << "\"\n";
-    return false;
-  }
-  Mix_VolumeChunk(_bank[S_EAT], VOLUME_LEVEL);
-
-  _bank[S_EXPLOSION] = Mix_LoadWAV(SND_PATH_EXPLOSION);
-  if (!_bank[S_EXPLOSION]) {
-    std::cerr << "Error: Failed to load \"" << SND_PATH_EXPLOSION << "\"\n";
-    return false;
-  }
-  Mix_VolumeChunk(_bank[S_EXPLOSION], VOLUME_LEVEL);
-
-  _bank[S_MENUHOVER] = Mix_LoadWAV(SND_PATH_MENUHOVER);
-  if (!_bank[S_MENUHOVER]) {
-    std::cerr << "Error: Failed to load \"" << SND_PATH_MENUHOVER << "\"\n";
-    return false;
+// Returns false if any sounds failed to load. They're decoded by loadAssets, which reports
+// the ones that failed.
+bool SoundMaster::loadSounds() {
+  bool ok = true;
+  for (int i = 0; i < NUM_SOUNDS; i++) {
+    _bank[i] = takeSound((SoundType)i);
+    if (_bank[i])
+      Mix_VolumeChunk(_bank[i], VOLUME_LEVEL);
+    else
+      ok = false;
   }
-  Mix_VolumeChunk(_bank[S_MENUHOVER], VOLUME_LEVEL);
-
-  _bank[S_MENUSELECT] = Mix_LoadWAV(SND_PATH_MENUSELECT);
-  if (!_bank[S_MENUSELECT]) {
-    std::cerr << "Error: Failed to load \"" << SND_PATH_MENUSELECT << "\"\n";
-    return false;
-  }
-  Mix_VolumeChunk(_bank[S_MENUSELECT], VOLUME_LEVEL);
-
-  return true;
+  return ok;
 }
 
 bool initSounds() {
+  TRACE_ZONE("open audio");
   if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0)
     return false;
   return true;
@@ -11,6 +11,8 @@
 #include <SDL2/SDL_ttf.h> // For using fonts in SDL
 #include <SDL2/SDL_mixer.h> // For sounds
 
+#include "trace.h"
+
 #define NUM_SOUNDS 4
 #define SND_PATH_EAT "assets/sounds/eat.wav"
 #define SND_PATH_EXPLOSION "assets/sounds/explosion.wav"
@@ -31,6 +33,7 @@ public:
 	void toggleMuted(){ _muted = !_muted; } // Nice simple way to toggle a flag
 	bool isMuted(){ return _muted; }	
 	Mix_Chunk* getSound(SoundType sound_type);
+	void play(SoundType sound_type); // Unless muted, or the sound didn't load
 	bool loadSounds();
 private:
 	bool _muted;
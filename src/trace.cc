@@ -0,0 +1,124 @@
+#include "trace.h"
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#define TRACE_INSTANT_DUR UINT64_MAX // Duration that marks an instant event
+
+struct TraceEvent {
+	const char* name;
+	uint64_t start, dur; // Nanoseconds
+};
+
+// Written only by its own thread. count keeps going up as the ring wraps.
+struct TraceBuffer {
+	std::array<TraceEvent, TRACE_BUFFER_EVENTS> events;
+	std::atomic<uint64_t> count;
+	int tid;
+	const char* thread_name;
+};
+
+std::atomic<bool> g_trace_on(false);
+
+static std::chrono::steady_clock::time_point trace_epoch;
+static std::mutex buffers_lock; // Only taken when a thread records its first event, and by traceWrite
+static std::vector<std::unique_ptr<TraceBuffer>> buffers;
+static thread_local TraceBuffer* thread_buffer = nullptr;
+static thread_local const char* thread_name = nullptr;
+
+bool traceCompiledIn(){
+	#ifdef SNAKEPP_TRACE
+	return true;
+	#else
+	return false;
+	#endif
+}
+
+void traceStart(){
+	trace_epoch = std::chrono::steady_clock::now();
+	g_trace_on.store(true);
+}
+
+uint64_t traceNow(){
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - trace_epoch).count();
+}
+
+static TraceBuffer* threadBuffer(){
+	if (!thread_buffer){
+		std::unique_ptr<TraceBuffer> buffer(new TraceBuffer());
+		buffer->count.store(0);
+		buffer->thread_name = thread_name;
+		std::lock_guard<std::mutex> lock(buffers_lock);
+		buffer->tid = buffers.size()+1;
+		thread_buffer = buffer.get();
+		buffers.push_back(std::move(buffer));
+	}
+	return thread_buffer;
+}
+
+void traceThreadName(const char* name){
+	thread_name = name;
+	if (thread_buffer)
+		thread_buffer->thread_name = name;
+}
+
+static void record(const char* name, uint64_t start, uint64_t dur){
+	TraceBuffer* buffer = threadBuffer();
+	uint64_t n = buffer->count.load(std::memory_order_relaxed);
+	buffer->events[n % TRACE_BUFFER_EVENTS] = {.name=name, .start=start, .dur=dur};
+	buffer->count.store(n+1, std::memory_order_release);
+}
+
+void traceRecord(const char* name, uint64_t start, uint64_t end){
+	record(name, start, end - start);
+}
+
+void traceInstant(const char* name){
+	record(name, traceNow(), TRACE_INSTANT_DUR);
+}
+
+bool traceWrite(const std::string& path){
+	FILE* f = fopen(path.c_str(), "w");
+	if (!f){
+		std::cerr << "File Error: Could not write trace to \"" << path << "\"\n";
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(buffers_lock);
+	uint64_t written = 0, overwritten = 0;
+	const char* sep = "";
+	fprintf(f, "{\"traceEvents\":[\n");
+	for (const std::unique_ptr<TraceBuffer>& buffer : buffers){
+		if (buffer->thread_name){
+			fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+				sep, buffer->tid, buffer->thread_name);
+			sep = ",\n";
+		}
+		uint64_t count = buffer->count.load(std::memory_order_acquire);
+		uint64_t first = count > TRACE_BUFFER_EVENTS ? count - TRACE_BUFFER_EVENTS : 0;
+		overwritten += first;
+		for (uint64_t i = first; i < count; i++){
+			const TraceEvent& e = buffer->events[i % TRACE_BUFFER_EVENTS];
+			if (e.dur == TRACE_INSTANT_DUR)
+				fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}",
+					sep, e.name, e.start/1000.0, buffer->tid);
+			else
+				fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+					sep, e.name, e.start/1000.0, e.dur/1000.0, buffer->tid);
+			sep = ",\n";
+			written++;
+		}
+	}
+	fprintf(f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	bool ok = fclose(f) == 0;
+	printf("Wrote %llu trace events to %s", (unsigned long long)written, path.c_str());
+	if (overwritten)
+		printf(" (%llu older ones were overwritten)", (unsigned long long)overwritten);
+	printf("\n");
+	return ok;
+}
@@ -0,0 +1,61 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Timeline tracing in Chrome trace format, for finding out where a hitch went (open the file in
+// Perfetto or chrome://tracing). TRACE_ZONE("name") times the rest of the enclosing scope and
+// TRACE_INSTANT("name") marks a moment, e.g. a state change. Names must be string literals, only
+// the pointer is kept.
+//
+// Each thread records into a ring buffer of its own, with no locks, keeping its last
+// TRACE_BUFFER_EVENTS events. Nothing is recorded until traceStart(), and traceWrite() should only
+// be called once the other traced threads have stopped. Builds configured with -DSNAKEPP_TRACE=OFF
+// compile every zone out.
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#define TRACE_BUFFER_EVENTS (1 << 18) // Per thread (6 MB), about 10 minutes of the main thread
+
+extern std::atomic<bool> g_trace_on;
+
+bool traceCompiledIn(); // False if the zones were compiled out
+inline bool traceEnabled(){ return g_trace_on.load(std::memory_order_relaxed); }
+void traceStart();
+void traceThreadName(const char* name); // Name the calling thread in the trace
+bool traceWrite(const std::string& path); // Returns false if the file couldn't be written
+
+uint64_t traceNow(); // Nanoseconds since traceStart()
+void traceRecord(const char* name, uint64_t start, uint64_t end); // A zone on the calling thread
+void traceInstant(const char* name);
+
+#ifdef SNAKEPP_TRACE
+
+class TraceZone {
+public:
+	TraceZone(const char* name): _name(traceEnabled() ? name : nullptr), _start(_name ? traceNow() : 0){}
+	~TraceZone(){
+		if (_name)
+			traceRecord(_name, _start, traceNow());
+	}
+	TraceZone(const TraceZone&) = delete;
+	TraceZone& operator=(const TraceZone&) = delete;
+
+private:
+	const char* _name; // nullptr if tracing was off when the zone started
+	uint64_t _start;
+};
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(trace_zone_, __LINE__)(name)
+#define TRACE_INSTANT(name) do { if (traceEnabled()) traceInstant(name); } while (0)
+
+#else
+
+#define TRACE_ZONE(name) do {} while (0)
+#define TRACE_INSTANT(name) do {} while (0)
+
+#endif
+
+#endif // TRACE_H
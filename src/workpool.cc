@@ -0,0 +1,84 @@
+#include "workpool.h"
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <memory>
+
+struct WorkQueue {
+	std::mutex mtx;
+	std::deque<size_t> items;
+};
+
+// Owner takes from the front of its own queue
+static bool popOwn(WorkQueue& q, size_t& item){
+	std::lock_guard<std::mutex> lock(q.mtx);
+	if (q.items.empty())
+		return false;
+	item = q.items.front();
+	q.items.pop_front();
+	return true;
+}
+
+// Thieves take from the back of the fullest other queue
+static bool steal(std::vector<std::unique_ptr<WorkQueue>>& queues, int self, size_t& item){
+	while (true){
+		int victim = -1;
+		size_t most = 0;
+		for (size_t i = 0; i < queues.size(); i++){
+			if ((int)i == self)
+				continue;
+			std::lock_guard<std::mutex> lock(queues[i]->mtx);
+			if (queues[i]->items.size() > most){
+				most = queues[i]->items.size();
+				victim = i;
+			}
+		}
+		if (victim < 0)
+			return false; // Everyone is out of work
+
+		std::lock_guard<std::mutex> lock(queues[victim]->mtx);
+		if (queues[victim]->items.empty())
+			continue; // Someone beat us to it, look again
+		item = queues[victim]->items.back();
+		queues[victim]->items.pop_back();
+		return true;
+	}
+}
+
+int defaultThreadCount(){
+	int n = std::thread::hardware_concurrency();
+	return (n > 0) ? n : 1;
+}
+
+void parallelFor(size_t n, int nthreads, const std::function<void(size_t i, int worker)>& fn){
+	if (nthreads <= 0)
+		nthreads = defaultThreadCount();
+	if ((size_t)nthreads > n)
+		nthreads = (n > 0) ? n : 1;
+
+	if (nthreads == 1){
+		for (size_t i = 0; i < n; i++)
+			fn(i, 0);
+		return;
+	}
+
+	std::vector<std::unique_ptr<WorkQueue>> queues;
+	for (int w = 0; w < nthreads; w++){
+		queues.emplace_back(new WorkQueue());
+		for (size_t i = n*w/nthreads; i < n*(w+1)/nthreads; i++)
+			queues[w]->items.push_back(i);
+	}
+
+	std::vector<std::thread> threads;
+	for (int w = 0; w < nthreads; w++){
+		threads.emplace_back([&, w](){
+			size_t item;
+			while (popOwn(*queues[w], item) || steal(queues, w, item))
+				fn(item, w);
+		});
+	}
+	for (std::thread& t : threads)
+		t.join();
+}
@@ -0,0 +1,18 @@
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+// Minimal work-stealing scheduler for headless jobs (tournaments, batch exports).
+// Each worker starts with its own contiguous share of the items and works through it front to back.
+// Once its share runs dry it steals from the back of whichever worker has the most left, so a few
+// long jobs (e.g. games that survive for ages) don't leave the other cores idle.
+
+#include <cstddef>
+#include <functional>
+
+// Runs fn(i, worker) for every i in [0, n) on nthreads threads (0 = one per core) and blocks until
+// all are done. worker is in [0, nthreads), handy for per-thread scratch state.
+void parallelFor(size_t n, int nthreads, const std::function<void(size_t i, int worker)>& fn);
+
+int defaultThreadCount(); // Number of hardware threads, at least 1
+
+#endif // WORKPOOL_H
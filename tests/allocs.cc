@@ -0,0 +1,69 @@
+// Plays autopilot games offscreen for a fixed number of frames, with the simulation pumped on the
+// main thread like --single-thread does, and fails if any gameplay frame made a heap allocation.
+// Same rule as snake++ --check-allocs: frames that drew new text are let off. Needs a build
+// configured with -DSNAKEPP_COUNT_ALLOCS=ON, and the font (run from the source directory).
+
+#include <cstdio>
+
+#include "allocs.h"
+#include "graphics.h"
+#include "simulation.h"
+
+#define TEST_FRAMES 2000
+#define TEST_WARMUP_FRAMES 30 // Buffers are sized and text first drawn in these
+#define TEST_SEED 1234
+
+int main(){
+	if (!allocCountingEnabled()){
+		fprintf(stderr, "Fatal error: Needs a build configured with -DSNAKEPP_COUNT_ALLOCS=ON\n");
+		return EXIT_FAILURE;
+	}
+	if (SDL_Init(0)){
+		fprintf(stderr, "Fatal error: Failed to initialize SDL: %s\n", SDL_GetError());
+		return EXIT_FAILURE;
+	}
+	g_gamemaster = std::unique_ptr<GameMaster>(new GameMaster());
+	if (!initFonts())
+		return EXIT_FAILURE;
+
+	int failed = 0, checked = 0, games = 1;
+	{
+		GFX gfx(GT_OFFSCREEN);
+		Simulation sim(BOARD_COLS, BOARD_ROWS, TEST_SEED, AUTOPILOT_BUDGET_US, 0, false, "");
+		sim.send(SimCommand::turbo(true));
+		sim.send(SimCommand::run(level_hz[0], 1, true));
+		for (int frame = 0; frame < TEST_FRAMES; frame++){
+			uint64_t allocs = allocCount(), text_misses = gfx.textCache().misses();
+			sim.pump();
+			const FrameSnapshot& snap = sim.latest();
+			gfx.renderClear();
+			gfx.renderSnapshot(snap);
+			char hud[32];
+			snprintf(hud, sizeof(hud), "SCORE: %zu", snap.length-1);
+			gfx.renderText(hud, (GRID_CELL_SIZE/2), (GRID_CELL_SIZE/2), WHITE, F_SMALL);
+			gfx.renderPresent();
+			allocs = allocCount() - allocs;
+
+			if (snap.state == SS_OVER){ // Starting over is allowed to allocate, it's not a gameplay frame
+				sim.send(SimCommand::newGame());
+				sim.send(SimCommand::run(level_hz[0], 1, true));
+				games++;
+				continue;
+			}
+			if (frame < TEST_WARMUP_FRAMES || gfx.textCache().misses() != text_misses)
+				continue;
+			checked++;
+			if (allocs > 0){
+				failed++;
+				fprintf(stderr, "Frame %d (tick %llu) made %llu heap allocations\n", frame,
+					(unsigned long long)snap.tick, (unsigned long long)allocs);
+			}
+		}
+	}
+
+	printf("Alloc test: %d of %d gameplay frames allocated, over %d games\n", failed, checked, games);
+	freeFonts();
+	TTF_Quit();
+	SDL_Quit();
+	return (failed == 0 && checked > 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,162 @@
+// Steps BatchSim lanes and GameCores side by side, with the same seeds and moves, and fails on the
+// first tick where any lane and its game disagree. Run for the SIMD kernel the build has and for
+// the scalar one, on every preset board. The moves come from a fixed seed and mostly avoid dying
+// straight away, so games run long enough to eat, grow and fill up the bitplane.
+// Also checks that with auto reset off, finished lanes stay exactly as they ended.
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "batch.h"
+#include "geometry.h"
+
+#define TEST_LANES 13 // Not a multiple of the SIMD width, so the padding lanes get used too
+#define TEST_TICKS 20000
+#define TEST_SEED 99
+#define TEST_HOLD_TICKS 50 // Steps a finished lane is left to sit through
+
+static const MoveDir ALL_DIRS[] = { M_LEFT, M_DOWN, M_RIGHT, M_UP };
+
+// A random move that doesn't end the game, if there is one (and a random one now and then anyway)
+static MoveDir pickMove(const GameCore& game, Rng& rng){
+	MoveDir dir = ALL_DIRS[rng.bounded(4)];
+	if (rng.bounded(1000) == 0)
+		return dir;
+	for (int i = 0; i < 4; i++){
+		MoveDir d = ALL_DIRS[(dir+i)%4];
+		if (!isReverse(d, game.getDir()) && !game.blocked(moveCell(game.getHead(), d)))
+			return d;
+	}
+	return dir;
+}
+
+// Compares lane i with game after a tick. Returns false, and says why, if they differ.
+static bool sameState(const BatchSim& sim, int i, const GameCore& game, StepResult sim_res,
+		StepResult game_res, uint64_t tick, std::vector<uint64_t>& bits){
+	const char* what = nullptr;
+	Cell food = game.getFood();
+	if (sim_res != game_res)
+		what = "step result";
+	else if (game_res == SR_HIT_WALL) // The lane stops before moving the head off the board, the game doesn't
+		return true;
+	else if (sim.headX()[i] != game.getHead().x || sim.headY()[i] != game.getHead().y)
+		what = "head";
+	else if (sim.dirs()[i] != game.getDir())
+		what = "direction";
+	else if ((size_t)sim.lengths()[i] != game.length())
+		what = "length";
+	else if (sim.foods()[i] != food.y*game.cols() + food.x)
+		what = "food";
+	else {
+		bits.assign(sim.wordsPerBoard(), 0);
+		const BodyRing& body = game.getBody();
+		for (size_t c = 0; c < body.size(); c++)
+			bits[body[c]/64] |= 1ULL << (body[c]%64);
+		for (int w = 0; w < sim.wordsPerBoard() && !what; w++)
+			if (sim.occupancy(i)[w] != bits[w])
+				what = "body";
+	}
+	if (what)
+		fprintf(stderr, "%s kernel, %dx%d board, lane %d, tick %llu: %s differs\n", sim.kernelName(),
+			game.cols(), game.rows(), i, (unsigned long long)tick, what);
+	return !what;
+}
+
+// Returns false if any lane went off course
+static bool runParity(BoardSize size, bool scalar){
+	int cols = boardCols(size), rows = boardRows(size);
+	BatchSim sim(TEST_LANES, cols, rows, TEST_SEED);
+	sim.useScalarKernel(scalar);
+	// Each lane's RNG is seeded like BatchSim seeds it, so food lands in the same places
+	std::vector<std::unique_ptr<GameCore>> games;
+	for (int i = 0; i < TEST_LANES; i++)
+		games.push_back(std::unique_ptr<GameCore>(new GameCore(cols, rows, splitMix64(TEST_SEED ^ splitMix64(i)))));
+
+	Rng moves(TEST_SEED);
+	std::vector<int32_t> actions(TEST_LANES);
+	std::vector<uint8_t> results(TEST_LANES);
+	std::vector<uint64_t> bits;
+	int played = TEST_LANES;
+	for (uint64_t tick = 0; tick < TEST_TICKS; tick++){
+		for (int i = 0; i < TEST_LANES; i++){
+			if (games[i]->isGameOver()){ // The lane restarts at the start of this step
+				games[i]->reset();
+				played++;
+			}
+			actions[i] = pickMove(*games[i], moves);
+		}
+		sim.step(actions.data(), results.data());
+		for (int i = 0; i < TEST_LANES; i++){
+			StepResult res = games[i]->step((MoveDir)actions[i]);
+			if (!sameState(sim, i, *games[i], (StepResult)results[i], res, tick, bits)){
+				printf("%-6s kernel, %-6s board: FAILED\n", sim.kernelName(), boardSizeName(size));
+				return false;
+			}
+		}
+	}
+	printf("%-6s kernel, %-6s board: ok (%d games over %d ticks)\n", sim.kernelName(), boardSizeName(size),
+		played, TEST_TICKS);
+	return true;
+}
+
+// Everything step() could change about lane i, to compare before and after
+static std::vector<int64_t> laneState(const BatchSim& sim, int i){
+	std::vector<int64_t> state = { sim.headX()[i], sim.headY()[i], sim.dirs()[i], sim.lengths()[i],
+		sim.foods()[i], sim.done()[i] };
+	state.insert(state.end(), sim.occupancy(i), sim.occupancy(i) + sim.wordsPerBoard());
+	return state;
+}
+
+// Runs lanes with auto reset off until they've all finished, and fails if a lane changes at all
+// after the step that finished it
+static bool runHold(BoardSize size, bool scalar){
+	BatchSim sim(TEST_LANES, boardCols(size), boardRows(size), TEST_SEED);
+	sim.useScalarKernel(scalar);
+	sim.setAutoReset(false);
+	Rng moves(TEST_SEED);
+	std::vector<int32_t> actions(TEST_LANES);
+	std::vector<uint8_t> results(TEST_LANES);
+	std::vector<std::vector<int64_t>> final_state(TEST_LANES);
+	std::vector<int> held(TEST_LANES, 0);
+	for (uint64_t tick = 0; tick < TEST_TICKS; tick++){
+		for (int i = 0; i < TEST_LANES; i++)
+			actions[i] = ALL_DIRS[moves.bounded(4)]; // Random walks, so every lane dies soon
+		sim.step(actions.data(), results.data());
+		bool all_held = true;
+		for (int i = 0; i < TEST_LANES; i++){
+			if (!sim.done()[i])
+				continue;
+			if (final_state[i].empty())
+				final_state[i] = laneState(sim, i);
+			else if (laneState(sim, i) != final_state[i]){
+				fprintf(stderr, "%s kernel, %s board, lane %d, tick %llu: finished lane changed\n",
+					sim.kernelName(), boardSizeName(size), i, (unsigned long long)tick);
+				printf("%-6s kernel, %-6s board, auto reset off: FAILED\n", sim.kernelName(), boardSizeName(size));
+				return false;
+			}
+			else
+				held[i]++;
+		}
+		for (int i = 0; i < TEST_LANES; i++)
+			all_held &= held[i] >= TEST_HOLD_TICKS;
+		if (all_held){
+			printf("%-6s kernel, %-6s board, auto reset off: ok\n", sim.kernelName(), boardSizeName(size));
+			return true;
+		}
+	}
+	printf("%-6s kernel, %-6s board, auto reset off: FAILED (lanes still running after %d ticks)\n",
+		sim.kernelName(), boardSizeName(size), TEST_TICKS);
+	return false;
+}
+
+int main(){
+	bool ok = true;
+	for (BoardSize size : {BS_SMALL, BS_MEDIUM, BS_LARGE}){
+		ok &= runParity(size, false);
+		ok &= runParity(size, true);
+		ok &= runHold(size, false);
+		ok &= runHold(size, true);
+	}
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
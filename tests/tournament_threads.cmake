@@ -0,0 +1,26 @@
+# Plays the same tournament on one thread and on several, and fails unless every game came out
+# the same. The autopilot gets a budget it never runs into, so its moves don't depend on timing.
+#
+# Run by ctest: cmake -DTOURNAMENT=<snake++-tournament> -DWORK_DIR=<dir> -P tournament_threads.cmake
+
+set(ARGS --games=4 --seed=42 --max-ticks=2000 --board=small --policies=random,greedy,autopilot
+    --plan-budget=10000000)
+
+foreach (THREADS 1 4)
+    execute_process(
+        COMMAND "${TOURNAMENT}" ${ARGS} --threads=${THREADS} "--results=${WORK_DIR}/results-${THREADS}.txt"
+        OUTPUT_QUIET
+        RESULT_VARIABLE RESULT
+    )
+    if (NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "Tournament on ${THREADS} threads failed: ${RESULT}")
+    endif()
+endforeach()
+
+execute_process(
+    COMMAND "${CMAKE_COMMAND}" -E compare_files "${WORK_DIR}/results-1.txt" "${WORK_DIR}/results-4.txt"
+    RESULT_VARIABLE DIFFERENT
+)
+if (DIFFERENT)
+    message(FATAL_ERROR "Per-game results differ between 1 and 4 threads, see ${WORK_DIR}/results-*.txt")
+endif()
@@ -0,0 +1,18 @@
+#ifndef ARGS_H
+#define ARGS_H
+
+// Command line helpers shared by the tools
+
+#include <cstring>
+#include <string>
+
+// Returns true and sets value if arg looks like --name=value
+inline bool getOpt(const char* arg, const char* name, std::string& value){
+	size_t len = strlen(name);
+	if (strncmp(arg, name, len) != 0 || arg[len] != '=')
+		return false;
+	value = arg + len + 1;
+	return true;
+}
+
+#endif // ARGS_H
@@ -0,0 +1,83 @@
+// snake++-bench: times the hot paths of the game rules on every preset board.
+//
+// Usage: snake++-bench [--calls=N] [--seed=N]
+//
+// pickFree (food placement) skips 512-cell blocks by their free counts, then counts words in one
+// block, so its cost still grows a little with the board and depends on where the k-th free cell
+// is. It's timed on boards filled to a few levels, with the taken cells scattered at random.
+// A plain GameCore::step is timed too, for scale.
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "args.h"
+#include "core.h"
+#include "geometry.h"
+
+static const double FILLS[] = { 0, 0.5, 0.9, 0.99 }; // Share of the board taken
+
+static double nsPer(std::chrono::steady_clock::time_point start, int calls){
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now()-start).count()/calls;
+}
+
+int main(int argc, char* argv[]){
+	int calls = 1000000;
+	uint64_t seed = 1;
+	for (int i = 1; i < argc; i++){
+		std::string v;
+		if (getOpt(argv[i], "--calls", v)) calls = std::stoi(v);
+		else if (getOpt(argv[i], "--seed", v)) seed = std::stoull(v);
+		else {
+			fprintf(stderr, "Unknown option: %s\n", argv[i]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (calls <= 0){
+		fprintf(stderr, "Usage: snake++-bench [--calls=N] [--seed=N]\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("%-8s %8s %8s %6s %14s\n", "board", "cells", "words", "fill", "pickFree ns");
+	uint64_t sink = 0; // So the calls aren't optimized away
+	for (BoardSize size : {BS_SMALL, BS_MEDIUM, BS_LARGE}){
+		int cols = boardCols(size), rows = boardRows(size), cells = cols*rows;
+		for (double fill : FILLS){
+			// Take a random share of the cells
+			Rng rng(seed);
+			OccupancyGrid grid(cols, rows);
+			std::vector<CellIndex> order(cells);
+			for (int i = 0; i < cells; i++)
+				order[i] = i;
+			for (int i = cells-1; i > 0; i--)
+				std::swap(order[i], order[rng.bounded(i+1)]);
+			for (int i = 0; i < (int)(fill*cells); i++)
+				grid.add(order[i]);
+
+			auto start = std::chrono::steady_clock::now();
+			for (int c = 0; c < calls; c++){
+				int i;
+				if (grid.pickFree(rng, -1, i))
+					sink += i;
+			}
+			printf("%-8s %8d %8d %5.0f%% %14.1f\n", boardSizeName(size), cells, (cells+63)/64, fill*100,
+				nsPer(start, calls));
+		}
+	}
+
+	// A tick for comparison, on a snake going round a small square
+	printf("\n%-8s %14s\n", "board", "step ns");
+	for (BoardSize size : {BS_SMALL, BS_MEDIUM, BS_LARGE}){
+		GameCore game(boardCols(size), boardRows(size), seed);
+		static const MoveDir LOOP[] = { M_RIGHT, M_DOWN, M_LEFT, M_UP };
+		auto start = std::chrono::steady_clock::now();
+		for (int c = 0; c < calls; c++){
+			if (game.isGameOver())
+				game.reset();
+			sink += game.step(LOOP[(c/4)%4]);
+		}
+		printf("%-8s %14.1f\n", boardSizeName(size), nsPer(start, calls));
+	}
+	return sink == 42 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,134 @@
+// snake++-export: renders frames of a replay to image files, with no window or GPU, for making
+// clips and thumbnails of archived games on a headless machine.
+//
+// Usage: snake++-export --replay=FILE --out=DIR [--from=TICK] [--to=TICK] [--step=N]
+//                       [--threads=N] [--format=png|rgba]
+//
+// Writes DIR/frame-<tick>.png for every step'th tick from --from to --to (default: the whole game),
+// or .rgba files of raw SCREEN_W x SCREEN_H RGBA pixels. Frames are rendered in chunks of
+// consecutive ticks spread over all cores, each thread with its own offscreen GFX: a chunk seeks
+// to its first tick once and steps the replay from there. It needs the font, from assets.pak next
+// to it or assets/ in the working directory.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+#include "args.h"
+#include "graphics.h"
+#include "replay.h"
+#include "replayview.h"
+#include "save.h" // NUM_DIFFS
+#include "workpool.h"
+
+#define EXPORT_CHUNK_FRAMES 64 // Frames per work item
+
+static bool writeRaw(const std::string& path, const std::vector<uint8_t>& rgba){
+	std::ofstream out(path, std::ios::binary);
+	out.write((const char*)rgba.data(), rgba.size());
+	if (!out){
+		std::cerr << "File Error: Couldn't write \"" << path << "\"\n";
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char* argv[]){
+	std::string replay_path, out_dir, format = "png";
+	long long from = 0, to = -1, step = 1;
+	int threads = 0;
+	for (int i = 1; i < argc; i++){
+		std::string v;
+		if (getOpt(argv[i], "--replay", v)) replay_path = v;
+		else if (getOpt(argv[i], "--out", v)) out_dir = v;
+		else if (getOpt(argv[i], "--from", v)) from = std::stoll(v);
+		else if (getOpt(argv[i], "--to", v)) to = std::stoll(v);
+		else if (getOpt(argv[i], "--step", v)) step = std::stoll(v);
+		else if (getOpt(argv[i], "--threads", v)) threads = std::stoi(v);
+		else if (getOpt(argv[i], "--format", v)) format = v;
+		else {
+			fprintf(stderr, "Unknown option \"%s\"\n", argv[i]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (replay_path.empty() || out_dir.empty() || step < 1 || (format != "png" && format != "rgba")){
+		fprintf(stderr, "Usage: snake++-export --replay=FILE --out=DIR [--from=TICK] [--to=TICK] [--step=N]"
+			" [--threads=N] [--format=png|rgba]\n");
+		return EXIT_FAILURE;
+	}
+
+	Replay replay;
+	if (!replay.open(replay_path)){
+		std::cerr << "Error: \"" << replay_path << "\" is not a valid replay file.\n";
+		return EXIT_FAILURE;
+	}
+	if (to < 0 || to > replay.numTicks())
+		to = replay.numTicks();
+	from = std::max(0LL, std::min(from, to));
+	size_t frames = (to-from)/step + 1;
+	size_t chunks = (frames + EXPORT_CHUNK_FRAMES-1)/EXPORT_CHUNK_FRAMES;
+	if (threads <= 0)
+		threads = defaultThreadCount();
+	threads = std::max(1, std::min(threads, (int)chunks));
+
+	// Only fonts are needed, no video or audio
+	if (SDL_Init(0)){
+		fprintf(stderr, "Fatal error: Failed to initialize SDL: %s\n", SDL_GetError());
+		return EXIT_FAILURE;
+	}
+	g_gamemaster = std::unique_ptr<GameMaster>(new GameMaster());
+	if (!initFonts())
+		return EXIT_FAILURE;
+
+	// One renderer and one game per thread, made up front
+	std::vector<std::unique_ptr<GFX>> gfxs;
+	std::vector<std::unique_ptr<GameCore>> games;
+	for (int i = 0; i < threads; i++){
+		gfxs.push_back(std::unique_ptr<GFX>(new GFX(GT_OFFSCREEN)));
+		games.push_back(replay.newGame());
+	}
+
+	std::cout << "Exporting " << frames << " frames (ticks " << from << "-" << to << ", every " << step
+		<< ") on " << threads << " threads\n";
+	std::atomic<size_t> written(0);
+	std::atomic<bool> failed(false);
+	auto start = std::chrono::steady_clock::now();
+	parallelFor(chunks, threads, [&](size_t chunk, int worker){
+		const GFX& gfx = *gfxs[worker];
+		GameCore& game = *games[worker];
+		std::vector<uint8_t> rgba;
+		size_t first = chunk*EXPORT_CHUNK_FRAMES, last = std::min(frames, first+EXPORT_CHUNK_FRAMES);
+		replay.seek(game, from + first*step);
+		for (size_t f = first; f < last && !failed; f++){
+			for (uint64_t tick = from + f*step; game.getTick() < tick && replay.stepGame(game);); // Catch up to the frame's tick
+			gfx.renderClear();
+			renderReplayFrame(&gfx, replay, game, "");
+			gfx.renderPresent();
+
+			char name[32];
+			// Named by the tick asked for, the game stops short of it once the replay has ended
+			snprintf(name, sizeof(name), "/frame-%06llu.%s", (unsigned long long)(from + f*step), format.c_str());
+			bool ok = (format == "png") ? gfx.savePNG(out_dir + name)
+				: gfx.readPixels(rgba) && writeRaw(out_dir + name, rgba);
+			if (!ok)
+				failed = true;
+			else
+				written++;
+		}
+	});
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+
+	// How long the exported stretch of the game took to play, at its level's tick rate
+	int level = replay.header().level;
+	double hz = (level >= 1 && level <= NUM_DIFFS) ? level_hz[level-1] : FPS;
+	double game_seconds = (to-from)/hz;
+	printf("Wrote %zu frames in %.2f s (%.0f frames/s, %.1fx real time)\n", written.load(), seconds,
+		written/std::max(seconds, 1e-9), game_seconds/std::max(seconds, 1e-9));
+
+	gfxs.clear();
+	freeFonts();
+	TTF_Quit();
+	SDL_Quit();
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
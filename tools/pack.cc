@@ -0,0 +1,153 @@
+// snake++-pack: packs asset files into one asset pack (see src/assetpack.h), run by the build.
+//
+// Usage: snake++-pack (--out=FILE | --embed=FILE.cc) PATH...
+//
+// Every file under each PATH goes in, under its path as given (run it from the directory the game
+// looks for assets/ in, and pass assets). --out writes the pack itself, --embed writes it as a C++
+// source file defining g_embedded_pack, for linking the pack into the executable.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "args.h"
+#include "assetpack.h"
+
+namespace fs = std::filesystem;
+
+struct PackFile {
+	std::string path;
+	std::vector<char> bytes;
+};
+
+static bool readFile(const fs::path& path, PackFile& file){
+	std::ifstream in(path, std::ios::binary);
+	if (!in)
+		return false;
+	file.path = path.generic_string(); // Forward slashes everywhere
+	file.bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	return !in.bad();
+}
+
+// The whole pack in memory, entries sorted by path
+static bool buildPack(std::vector<PackFile>& files, std::vector<char>& pack){
+	std::sort(files.begin(), files.end(), [](const PackFile& a, const PackFile& b){ return a.path < b.path; });
+	PackHeader header = {};
+	memcpy(header.magic, PACK_MAGIC, 4);
+	header.version = PACK_VERSION;
+	header.count = files.size();
+
+	std::vector<PackEntry> entries(files.size());
+	size_t offset = sizeof(PackHeader) + files.size()*sizeof(PackEntry);
+	for (size_t i = 0; i < files.size(); i++){
+		if (files[i].path.size() >= PACK_PATH_LEN){
+			std::cerr << "Error: \"" << files[i].path << "\" is too long a path for an asset pack ("
+				<< PACK_PATH_LEN-1 << " characters at most)\n";
+			return false;
+		}
+		if (i > 0 && files[i].path == files[i-1].path){
+			std::cerr << "Error: \"" << files[i].path << "\" was given twice\n";
+			return false;
+		}
+		offset = (offset + PACK_ALIGN-1)/PACK_ALIGN*PACK_ALIGN;
+		if (offset + files[i].bytes.size() > UINT32_MAX){
+			std::cerr << "Error: Asset pack would be over 4 GB\n";
+			return false;
+		}
+		strcpy(entries[i].path, files[i].path.c_str());
+		entries[i].offset = offset;
+		entries[i].size = files[i].bytes.size();
+		offset += files[i].bytes.size();
+	}
+
+	pack.assign(offset, 0); // Zeroes between entries too, so the same assets make the same pack
+	memcpy(pack.data(), &header, sizeof(header));
+	memcpy(pack.data() + sizeof(header), entries.data(), entries.size()*sizeof(PackEntry));
+	for (size_t i = 0; i < files.size(); i++)
+		std::copy(files[i].bytes.begin(), files[i].bytes.end(), pack.begin() + entries[i].offset);
+	return true;
+}
+
+static bool writePack(const std::string& path, const std::vector<char>& pack){
+	std::ofstream out(path, std::ios::binary);
+	out.write(pack.data(), pack.size());
+	if (!out){
+		std::cerr << "File Error: Couldn't write \"" << path << "\"\n";
+		return false;
+	}
+	return true;
+}
+
+static bool writeEmbedded(const std::string& path, const std::vector<char>& pack){
+	std::ofstream out(path);
+	out << "// Generated by snake++-pack, don't edit\n"
+		<< "#include <cstddef>\n\n"
+		<< "alignas(" << PACK_ALIGN << ") extern const unsigned char g_embedded_pack[] = {";
+	char num[8];
+	for (size_t i = 0; i < pack.size(); i++){
+		snprintf(num, sizeof(num), "%s%u,", (i % 24 == 0) ? "\n\t" : "", (unsigned char)pack[i]);
+		out << num;
+	}
+	out << "\n};\nextern const size_t g_embedded_pack_size = " << pack.size() << ";\n";
+	if (!out){
+		std::cerr << "File Error: Couldn't write \"" << path << "\"\n";
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char* argv[]){
+	std::string out_path, embed_path;
+	std::vector<std::string> inputs;
+	for (int i = 1; i < argc; i++){
+		std::string v;
+		if (getOpt(argv[i], "--out", v)) out_path = v;
+		else if (getOpt(argv[i], "--embed", v)) embed_path = v;
+		else if (strncmp(argv[i], "--", 2) == 0){
+			fprintf(stderr, "Unknown option \"%s\"\n", argv[i]);
+			return EXIT_FAILURE;
+		}
+		else inputs.push_back(argv[i]);
+	}
+	if ((out_path.empty() && embed_path.empty()) || inputs.empty()){
+		fprintf(stderr, "Usage: snake++-pack (--out=FILE | --embed=FILE.cc) PATH...\n");
+		return EXIT_FAILURE;
+	}
+
+	std::vector<PackFile> files;
+	for (const std::string& input : inputs){
+		std::error_code err;
+		std::vector<fs::path> paths;
+		if (fs::is_directory(input, err)){
+			for (const fs::directory_entry& entry : fs::recursive_directory_iterator(input, err)){
+				if (entry.is_regular_file())
+					paths.push_back(entry.path());
+			}
+		}
+		else
+			paths.push_back(input);
+		for (const fs::path& path : paths){
+			files.emplace_back();
+			if (err || !readFile(path, files.back())){
+				std::cerr << "File Error: Couldn't read \"" << path.generic_string() << "\"\n";
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	std::vector<char> pack;
+	if (!buildPack(files, pack))
+		return EXIT_FAILURE;
+	if (!out_path.empty() && !writePack(out_path, pack))
+		return EXIT_FAILURE;
+	if (!embed_path.empty() && !writeEmbedded(embed_path, pack))
+		return EXIT_FAILURE;
+	printf("Packed %zu files into %zu bytes\n", files.size(), pack.size());
+	return EXIT_SUCCESS;
+}
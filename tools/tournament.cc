@@ -0,0 +1,217 @@
+// snake++-tournament: plays many headless games per policy at every difficulty level,
+// spread over all cores, and writes a summary of how each policy did.
+//
+// Usage: snake++-tournament [--games=N] [--threads=N] [--seed=N] [--max-ticks=N]
+//                           [--policies=a,b,...] [--plan-budget=US] [--board=SIZE] [--out=FILE]
+//                           [--results=FILE]
+//
+// Every game gets its own seed derived from (seed, policy, level, game #), and results are stored
+// by game index, so reports are identical no matter how many threads ran them. The exception is
+// the autopilot when a plan runs into its per-tick budget (--plan-budget, in microseconds):
+// the move it falls back to depends on how fast the machine is.
+// --results writes one line per game (policy, level, game, seed, score, ticks, won) with nothing
+// timing related in it, for checking that two runs played the same games.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "args.h"
+#include "autopilot.h"
+#include "core.h"
+#include "geometry.h"
+#include "policy.h"
+#include "save.h" // NUM_DIFFS
+#include "workpool.h"
+
+struct GameResult {
+	int score;
+	uint64_t ticks;
+	bool won;
+	double seconds; // Time spent simulating this game (not deterministic, only used for throughput)
+	PlanStats plan; // Planner timings, all zero unless the policy is the autopilot
+};
+
+// Turns (seed, policy, level, game) into a well mixed per-game seed
+static uint64_t gameSeed(uint64_t seed, int policy, int level, int game){
+	return splitMix64(seed ^ splitMix64(((uint64_t)policy << 48) ^ ((uint64_t)level << 32) ^ (uint64_t)game));
+}
+
+static std::vector<std::string> splitCommas(const std::string& s){
+	std::vector<std::string> out;
+	std::stringstream ss(s);
+	std::string item;
+	while (std::getline(ss, item, ','))
+		if (!item.empty())
+			out.push_back(item);
+	return out;
+}
+
+static double percentile(const std::vector<int>& sorted, double p){
+	if (sorted.empty())
+		return 0;
+	return sorted[std::min(sorted.size()-1, (size_t)(p*sorted.size()))];
+}
+
+int main(int argc, char* argv[]){
+	int games = 100, threads = 0;
+	uint64_t seed = 1, max_ticks = 100000;
+	int plan_budget = AUTOPILOT_BUDGET_US;
+	BoardSize board = BS_MEDIUM;
+	// The autopilot survives orders of magnitude longer than the scripted policies, so it only
+	// plays when asked for with --policies
+	std::vector<std::string> policies = { "random", "greedy" };
+	std::string out_path, results_path;
+
+	for (int i = 1; i < argc; i++){
+		std::string v;
+		if (getOpt(argv[i], "--games", v)) games = std::stoi(v);
+		else if (getOpt(argv[i], "--threads", v)) threads = std::stoi(v);
+		else if (getOpt(argv[i], "--seed", v)) seed = std::stoull(v);
+		else if (getOpt(argv[i], "--max-ticks", v)) max_ticks = std::stoull(v);
+		else if (getOpt(argv[i], "--policies", v)) policies = splitCommas(v);
+		else if (getOpt(argv[i], "--plan-budget", v)) plan_budget = std::stoi(v);
+		else if (getOpt(argv[i], "--board", v)){
+			if (!parseBoardSize(v, board)){
+				fprintf(stderr, "Unknown board size: %s (try small, medium or large)\n", v.c_str());
+				return EXIT_FAILURE;
+			}
+		}
+		else if (getOpt(argv[i], "--out", v)) out_path = v;
+		else if (getOpt(argv[i], "--results", v)) results_path = v;
+		else {
+			fprintf(stderr, "Unknown option: %s\n", argv[i]);
+			return EXIT_FAILURE;
+		}
+	}
+	for (const std::string& name : policies){
+		if (!makePolicy(name, 0)){
+			fprintf(stderr, "Unknown policy: %s\n", name.c_str());
+			return EXIT_FAILURE;
+		}
+	}
+	if (threads <= 0)
+		threads = defaultThreadCount();
+	int cols = boardCols(board), rows = boardRows(board);
+
+	// One job per (policy, level, game), laid out policy-major
+	size_t per_policy = (size_t)NUM_DIFFS * games;
+	std::vector<GameResult> results(policies.size() * per_policy);
+
+	auto start = std::chrono::steady_clock::now();
+	parallelFor(results.size(), threads, [&](size_t job, int){
+		int p = job / per_policy;
+		int level = (job % per_policy) / games + 1;
+		int g = job % games;
+		uint64_t s = gameSeed(seed, p, level, g);
+
+		auto t0 = std::chrono::steady_clock::now();
+		GameCore game(cols, rows, s);
+		std::unique_ptr<Policy> policy = makePolicy(policies[p], splitMix64(s));
+		AutopilotPolicy* autopilot = dynamic_cast<AutopilotPolicy*>(policy.get());
+		if (autopilot)
+			autopilot->setBudget(plan_budget);
+		StepResult last = SR_MOVED;
+		while (!game.isGameOver() && game.getTick() < max_ticks)
+			last = game.step(policy->nextDir(game));
+
+		GameResult& r = results[job];
+		r.score = game.score();
+		r.ticks = game.getTick();
+		r.won = last == SR_WON;
+		r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+		if (autopilot)
+			r.plan = autopilot->stats();
+	});
+	double wall = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+
+	std::ostringstream report;
+	report << std::fixed << std::setprecision(2);
+	report << "Snake++ tournament: " << games << " games per level, seed " << seed
+		<< ", max " << max_ticks << " ticks, " << threads << " threads\n";
+	report << "Board " << cols << "x" << rows << " (" << boardSizeName(board) << "). Levels only change tick speed in the game, "
+		"so here they are independent seed streams.\n\n";
+
+	for (size_t p = 0; p < policies.size(); p++){
+		report << "== " << policies[p] << " ==\n";
+		report << std::setw(6) << "level" << std::setw(9) << "mean" << std::setw(8) << "sd"
+			<< std::setw(6) << "min" << std::setw(6) << "p50" << std::setw(6) << "p90" << std::setw(6) << "max"
+			<< std::setw(12) << "mean ticks" << std::setw(6) << "won" << "\n";
+
+		std::vector<int> all_scores;
+		double cpu = 0, all_ticks = 0;
+		PlanStats plan = PlanStats();
+		for (int level = 1; level <= NUM_DIFFS; level++){
+			std::vector<int> scores;
+			double sum = 0, sum_sq = 0, ticks = 0;
+			int won = 0;
+			for (int g = 0; g < games; g++){
+				const GameResult& r = results[p*per_policy + (level-1)*games + g];
+				scores.push_back(r.score);
+				sum += r.score;
+				sum_sq += (double)r.score*r.score;
+				ticks += r.ticks;
+				won += r.won;
+				cpu += r.seconds;
+				plan.merge(r.plan);
+			}
+			std::sort(scores.begin(), scores.end());
+			double mean = sum/games;
+			report << std::setw(6) << level << std::setw(9) << mean
+				<< std::setw(8) << std::sqrt(std::max(0.0, sum_sq/games - mean*mean))
+				<< std::setw(6) << scores.front() << std::setw(6) << (int)percentile(scores, 0.5)
+				<< std::setw(6) << (int)percentile(scores, 0.9) << std::setw(6) << scores.back()
+				<< std::setw(12) << ticks/games << std::setw(6) << won << "\n";
+			all_scores.insert(all_scores.end(), scores.begin(), scores.end());
+			all_ticks += ticks;
+		}
+		std::sort(all_scores.begin(), all_scores.end());
+		double n = all_scores.size();
+		double mean = 0;
+		for (int sc : all_scores)
+			mean += sc/n;
+		report << "  overall: mean score " << mean << ", p50 " << (int)percentile(all_scores, 0.5)
+			<< ", mean survival " << all_ticks/n << " ticks, "
+			<< n/cpu << " games/s per core (" << all_ticks/cpu/1e6 << "M ticks/s)\n";
+		if (plan.plans > 0){
+			report << "  planner: mean " << plan.meanUs() << " us/tick, max " << plan.max_us << " us, "
+				<< plan.over_budget << " of " << plan.plans << " ticks hit the " << plan_budget << " us budget\n";
+			report << "  moves by stage: food " << 100.0*plan.stages[PS_FOOD]/plan.plans
+				<< "%, tail " << 100.0*plan.stages[PS_TAIL]/plan.plans
+				<< "%, cycle " << 100.0*plan.stages[PS_CYCLE]/plan.plans
+				<< "%, any " << 100.0*plan.stages[PS_ANY]/plan.plans << "%\n";
+		}
+		report << "\n";
+	}
+	report << "Total: " << results.size() << " games in " << wall << "s ("
+		<< results.size()/wall << " games/s)\n";
+
+	std::cout << report.str();
+	if (!out_path.empty()){
+		std::ofstream ofs(out_path);
+		if (!ofs){
+			std::cerr << "File Error: Failed to write report to \"" << out_path << "\"\n";
+			return EXIT_FAILURE;
+		}
+		ofs << report.str();
+	}
+	if (!results_path.empty()){
+		std::ofstream ofs(results_path);
+		for (size_t job = 0; job < results.size(); job++){
+			int p = job / per_policy, level = (job % per_policy) / games + 1, g = job % games;
+			const GameResult& r = results[job];
+			ofs << policies[p] << " " << level << " " << g << " " << gameSeed(seed, p, level, g) << " "
+				<< r.score << " " << r.ticks << " " << r.won << "\n";
+		}
+		if (!ofs){
+			std::cerr << "File Error: Failed to write results to \"" << results_path << "\"\n";
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}